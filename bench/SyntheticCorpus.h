@@ -0,0 +1,348 @@
+#pragma once
+
+// Deterministic synthetic libraries for benchmarks and load tests. The same seed
+// always yields the same items, so numbers are comparable across builds. Every
+// item is derived from (seed, index) alone, so a corpus can be streamed in
+// batches of any size without holding it in memory.
+
+#include "Database.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct CorpusOptions {
+    size_t items = 1000;
+    uint64_t seed = 42;
+    int collections = 200;        // distinct collection paths
+    int maxDepth = 4;             // deepest collection path, in segments
+    double nestRate = 0.5;        // share of collections nested under an earlier one
+    double abstractRate = 0.5;    // share of items with an abstract
+    // Field lengths, drawn uniformly from [min, max]
+    int titleWordsMin = 4, titleWordsMax = 14;
+    int abstractWordsMin = 60, abstractWordsMax = 250;
+    int authorsMin = 1, authorsMax = 5;
+    double duplicateRate = 0.0;   // share of items that re-describe an earlier item
+    double extraMembershipRate = 0.0; // share of items filed in more collections than their primary one
+    int maxExtraMemberships = 3;
+    double pdfRate = 0.0;         // share of items with a pdf_path under pdfDir
+    std::string pdfDir;
+};
+
+class SyntheticCorpus {
+public:
+    explicit SyntheticCorpus(const CorpusOptions &opts) : opts(opts), rng(opts.seed) {
+        collections = makeCollections();
+    }
+
+    const std::vector<std::string> &collectionPaths() const { return collections; }
+
+    std::vector<Item> makeItems() {
+        std::vector<Item> out;
+        out.reserve(opts.items);
+        for (size_t i = 0; i < opts.items; ++i) out.push_back(makeItem(i));
+        return out;
+    }
+
+    // Duplicates copy the identifying fields of an earlier item with the kind of
+    // noise real imports have: a DOI in URL form or upper case, or a retyped title
+    // with the identifiers missing.
+    Item makeItem(size_t index) {
+        reseed(index, 0);
+        bool duplicate = index > 0 && chance(opts.duplicateRate);
+        size_t source = duplicate ? uniform(0, index - 1) : 0;
+        int variant = (int)uniform(0, 2);
+
+        Item it = makeOriginal(index);
+        if (duplicate) {
+            Item src = makeOriginal(source);
+            it.type = src.type;
+            it.authors = src.authors;
+            it.year = src.year;
+            it.journal = src.journal;
+            it.booktitle = src.booktitle;
+            it.publisher = src.publisher;
+            if (variant == 0) {
+                it.title = src.title;
+                it.doi = src.doi.empty() ? std::string() : "https://doi.org/" + src.doi;
+                it.isbn = src.isbn;
+            } else if (variant == 1) {
+                it.title = src.title;
+                it.doi = upper(src.doi);
+                it.isbn = hyphenateIsbn(src.isbn);
+            } else {
+                it.title = lower(src.title) + ".";
+                it.doi.clear();
+                it.isbn.clear();
+            }
+        }
+        return it;
+    }
+
+    // Collections beyond the primary `collection` field, for multi-membership
+    std::vector<std::string> extraCollections(size_t index) {
+        std::vector<std::string> out;
+        reseed(index, 2);
+        if (collections.size() < 2 || !chance(opts.extraMembershipRate)) return out;
+        int n = (int)uniform(1, std::max(1, opts.maxExtraMemberships));
+        for (int i = 0; i < n; ++i) out.push_back(collections[uniform(0, collections.size() - 1)]);
+        return out;
+    }
+
+    // A small but well-formed PDF of roughly `bytes` bytes, so attachment code paths
+    // (size checks, hashing, copying) see realistic files.
+    static bool writeFakePdf(const Item &it, size_t bytes) {
+        if (it.pdf_path.empty()) return false;
+        std::string text = "(" + pdfEscape(it.title.substr(0, 80)) + ") Tj";
+        std::string content = "BT /F1 12 Tf 72 720 Td " + text + " ET";
+        std::vector<std::string> objects = {
+            "<< /Type /Catalog /Pages 2 0 R >>",
+            "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+            "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R /Resources << /Font << /F1 5 0 R >> >> >>",
+            "<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "\nendstream",
+            "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>",
+        };
+        std::string pdf = "%PDF-1.4\n";
+        // Comment lines pad the file to size without changing the document
+        while (pdf.size() + 600 < bytes) pdf += "%" + std::string(std::min<size_t>(254, bytes - pdf.size() - 600), 'x') + "\n";
+        std::vector<size_t> offsets;
+        for (size_t i = 0; i < objects.size(); ++i) {
+            offsets.push_back(pdf.size());
+            pdf += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+        }
+        size_t xref = pdf.size();
+        pdf += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+        for (size_t off : offsets) {
+            char line[32];
+            std::snprintf(line, sizeof(line), "%010zu 00000 n \n", off);
+            pdf += line;
+        }
+        pdf += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+        std::ofstream f(it.pdf_path, std::ios::binary);
+        f << pdf;
+        return bool(f);
+    }
+
+    // Streams items into one of the formats the importers read
+    class FileWriter {
+    public:
+        enum Format { BibTeX, ZoteroRDF, EndNoteXML, MendeleyXML };
+
+        FileWriter(const std::string &path, Format format) : f(path), format(format) {
+            if (!f) return;
+            switch (format) {
+            case BibTeX: break;
+            case ZoteroRDF:
+                f << "<rdf:RDF\n xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\"\n"
+                     " xmlns:z=\"http://www.zotero.org/namespaces/export#\"\n xmlns:dc=\"http://purl.org/dc/elements/1.1/\"\n"
+                     " xmlns:bib=\"http://purl.org/net/biblio#\">\n";
+                break;
+            case EndNoteXML: f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<xml><records>\n"; break;
+            case MendeleyXML: f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<documents>\n"; break;
+            }
+        }
+
+        void write(const Item &it) {
+            switch (format) {
+            case BibTeX: {
+                f << "@" << (it.type.empty() ? "misc" : it.type) << "{key" << n << ",\n";
+                auto field = [&](const char *name, const std::string &v) { if (!v.empty()) f << "  " << name << " = {" << v << "},\n"; };
+                field("author", it.authors); field("title", it.title); field("journal", it.journal);
+                field("booktitle", it.booktitle); field("publisher", it.publisher); field("address", it.address);
+                field("volume", it.volume); field("number", it.number); field("pages", it.pages);
+                field("doi", it.doi); field("isbn", it.isbn); field("url", it.url);
+                field("abstract", it.abstract); field("keywords", it.keywords);
+                if (!it.pdf_path.empty()) field("file", "Full Text:" + it.pdf_path + ":application/pdf");
+                f << "  year = {" << it.year << "}\n}\n\n";
+                break;
+            }
+            case ZoteroRDF:
+                f << "  <rdf:Description rdf:about=\"#item_" << n << "\">\n";
+                f << "    <dc:title>" << xml(it.title) << "</dc:title>\n";
+                f << "    <dc:creator>" << xml(it.authors) << "</dc:creator>\n";
+                f << "    <dc:date>" << it.year << "</dc:date>\n";
+                if (!it.publisher.empty()) f << "    <dc:publisher>" << xml(it.publisher) << "</dc:publisher>\n";
+                if (!it.doi.empty()) f << "    <dc:identifier>DOI " << xml(it.doi) << "</dc:identifier>\n";
+                if (!it.isbn.empty()) f << "    <dc:identifier>ISBN " << it.isbn << "</dc:identifier>\n";
+                f << "  </rdf:Description>\n";
+                break;
+            case EndNoteXML:
+                f << "<record>\n";
+                f << "<title>" << xml(it.title) << "</title>\n";
+                f << "<author>" << xml(it.authors) << "</author>\n";
+                f << "<year>" << it.year << "</year>\n";
+                if (!it.publisher.empty()) f << "<publisher>" << xml(it.publisher) << "</publisher>\n";
+                if (!it.doi.empty()) f << "<electronic-resource-num>" << xml(it.doi) << "</electronic-resource-num>\n";
+                f << "</record>\n";
+                break;
+            case MendeleyXML:
+                f << "<document>\n";
+                f << "<title>" << xml(it.title) << "</title>\n";
+                f << "<authors><author>" << xml(it.authors) << "</author></authors>\n";
+                f << "<year>" << it.year << "</year>\n";
+                if (!it.publisher.empty()) f << "<publisher>" << xml(it.publisher) << "</publisher>\n";
+                if (!it.doi.empty()) f << "<doi>" << xml(it.doi) << "</doi>\n";
+                f << "</document>\n";
+                break;
+            }
+            ++n;
+        }
+
+        bool close() {
+            switch (format) {
+            case BibTeX: break;
+            case ZoteroRDF: f << "</rdf:RDF>\n"; break;
+            case EndNoteXML: f << "</records></xml>\n"; break;
+            case MendeleyXML: f << "</documents>\n"; break;
+            }
+            f.close();
+            return !f.fail();
+        }
+
+        bool isOpen() const { return f.is_open(); }
+
+    private:
+        std::ofstream f;
+        Format format;
+        size_t n = 0;
+    };
+
+    static bool writeFile(const std::vector<Item> &items, const std::string &path, FileWriter::Format format) {
+        FileWriter w(path, format);
+        if (!w.isOpen()) return false;
+        for (const auto &it : items) w.write(it);
+        return w.close();
+    }
+    static bool writeBibTeX(const std::vector<Item> &items, const std::string &path) { return writeFile(items, path, FileWriter::BibTeX); }
+    static bool writeZoteroRDF(const std::vector<Item> &items, const std::string &path) { return writeFile(items, path, FileWriter::ZoteroRDF); }
+    static bool writeEndNoteXML(const std::vector<Item> &items, const std::string &path) { return writeFile(items, path, FileWriter::EndNoteXML); }
+    static bool writeMendeleyXML(const std::vector<Item> &items, const std::string &path) { return writeFile(items, path, FileWriter::MendeleyXML); }
+
+private:
+    CorpusOptions opts;
+    std::mt19937_64 rng;
+    std::vector<std::string> collections;
+
+    std::vector<std::string> makeCollections() {
+        std::vector<std::string> out;
+        out.reserve(opts.collections);
+        for (int i = 0; i < opts.collections; ++i) {
+            std::string path;
+            if (!out.empty() && chance(opts.nestRate)) {
+                const std::string &parent = out[uniform(0, out.size() - 1)];
+                if (depthOf(parent) < opts.maxDepth) path = parent + "/";
+            }
+            path += capitalize(word()) + " " + std::to_string(i);
+            out.push_back(path);
+        }
+        return out;
+    }
+
+    Item makeOriginal(size_t index) {
+        static const char *types[] = {"article", "article", "article", "book", "inproceedings", "techreport", "phdthesis", "misc"};
+        reseed(index, 1);
+        Item it;
+        it.id = "synthetic-" + std::to_string(opts.seed) + "-" + std::to_string(index);
+        it.type = types[uniform(0, 7)];
+        it.title = capitalize(sentence(opts.titleWordsMin, opts.titleWordsMax));
+        int nAuthors = (int)uniform(opts.authorsMin, std::max(opts.authorsMin, opts.authorsMax));
+        for (int a = 0; a < nAuthors; ++a) {
+            if (a) it.authors += " and ";
+            it.authors += capitalize(word()) + ", " + capitalize(word());
+        }
+        it.year = std::to_string(uniform(1950, 2025));
+        if (it.type == "article") {
+            it.journal = "Journal of " + capitalize(word()) + " " + capitalize(word());
+            it.volume = std::to_string(uniform(1, 120));
+            it.number = std::to_string(uniform(1, 12));
+            it.pages = std::to_string(uniform(1, 900)) + "--" + std::to_string(uniform(901, 1200));
+            it.doi = "10." + std::to_string(uniform(1000, 9999)) + "/synthetic." + std::to_string(index);
+        } else if (it.type == "book") {
+            it.publisher = capitalize(word()) + " Press";
+            it.address = capitalize(word());
+            it.isbn = "978" + std::to_string(uniform(1000000000ull, 9999999999ull));
+        } else if (it.type == "inproceedings") {
+            it.booktitle = "Proceedings of " + capitalize(sentence(2, 5));
+            it.pages = std::to_string(uniform(1, 300)) + "--" + std::to_string(uniform(301, 400));
+        }
+        if (chance(opts.abstractRate)) it.abstract = capitalize(sentence(opts.abstractWordsMin, opts.abstractWordsMax)) + ".";
+        it.keywords = word() + ", " + word() + ", " + word();
+        it.url = "https://example.org/items/" + std::to_string(index);
+        if (!collections.empty()) it.collection = collections[uniform(0, collections.size() - 1)];
+        if (!opts.pdfDir.empty() && chance(opts.pdfRate)) it.pdf_path = opts.pdfDir + "/" + it.id + ".pdf";
+        return it;
+    }
+
+    // Independent streams per item and purpose (0: duplicate choice, 1: fields, 2: memberships)
+    void reseed(size_t index, uint64_t stream) {
+        uint64_t x = opts.seed ^ (uint64_t(index) * 0x9E3779B97F4A7C15ull) ^ (stream << 56);
+        // splitmix64 finaliser so neighbouring indexes get unrelated states
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        rng.seed(x ^ (x >> 31));
+    }
+
+    uint64_t uniform(uint64_t lo, uint64_t hi) { return std::uniform_int_distribution<uint64_t>(lo, std::max(lo, hi))(rng); }
+    bool chance(double p) { return p > 0 && std::bernoulli_distribution(std::min(1.0, p))(rng); }
+
+    std::string word() {
+        static const char *syllables[] = {"ka","lo","mi","ne","ra","to","su","vi","de","po","an","el","or","um","is","ter","gra","phi","tion","ment"};
+        std::string w;
+        int n = (int)uniform(1, 4);
+        for (int i = 0; i < n; ++i) w += syllables[uniform(0, 19)];
+        return w;
+    }
+    std::string sentence(int minWords, int maxWords) {
+        std::string s;
+        int n = (int)uniform(minWords, maxWords);
+        for (int i = 0; i < n; ++i) { if (i) s += ' '; s += word(); }
+        return s;
+    }
+    static std::string capitalize(std::string s) {
+        if (!s.empty() && s[0] >= 'a' && s[0] <= 'z') s[0] = char(s[0] - 'a' + 'A');
+        return s;
+    }
+    static std::string upper(std::string s) {
+        for (char &c : s) if (c >= 'a' && c <= 'z') c = char(c - 'a' + 'A');
+        return s;
+    }
+    static std::string lower(std::string s) {
+        for (char &c : s) if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+        return s;
+    }
+    static std::string hyphenateIsbn(const std::string &isbn) {
+        if (isbn.size() != 13) return isbn;
+        return isbn.substr(0, 3) + "-" + isbn.substr(3, 1) + "-" + isbn.substr(4, 4) + "-" + isbn.substr(8, 4) + "-" + isbn.substr(12);
+    }
+    static int depthOf(const std::string &path) {
+        int d = 1;
+        for (char c : path) if (c == '/') ++d;
+        return d;
+    }
+    static std::string pdfEscape(const std::string &s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '(' || c == ')' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+    static std::string xml(const std::string &s) {
+        std::string out;
+        out.reserve(s.size());
+        for (char c : s) {
+            switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+            }
+        }
+        return out;
+    }
+};
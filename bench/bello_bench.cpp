@@ -0,0 +1,287 @@
+// bello_bench: headless benchmarks for the database, importers and BibTeX export.
+//
+//   bello_bench [--sizes=1000,100000] [--filter=substring] [--min-time=1.0]
+//               [--seed=42] [--out=results.json]
+//
+// Every benchmark runs over a synthetic corpus of each requested size (see
+// SyntheticCorpus.h). Results go to the console and, with --out, to a JSON file
+// laid out like Google Benchmark's so existing tooling can compare releases.
+
+#include "BibTeX.h"
+#include "Database.h"
+#include "Importers.h"
+#include "SyntheticCorpus.h"
+
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Benchmark {
+    std::string name;
+    int64_t itemsPerIteration = 0;   // reported as items_per_second
+    std::function<void()> setup;     // untimed, runs before every iteration (optional)
+    std::function<void()> run;
+};
+
+struct Result {
+    std::string name;
+    int64_t iterations = 0;
+    double realNs = 0;  // per iteration
+    double cpuNs = 0;
+    double itemsPerSecond = 0;
+};
+
+Result runBenchmark(const Benchmark &b, double minSeconds) {
+    using clock = std::chrono::steady_clock;
+    Result r;
+    r.name = b.name;
+    double realTotal = 0, cpuTotal = 0;
+    // At least one iteration; keep going until minSeconds of measured time or 1000 iterations
+    while (r.iterations == 0 || (realTotal < minSeconds && r.iterations < 1000)) {
+        if (b.setup) b.setup();
+        std::clock_t c0 = std::clock();
+        auto t0 = clock::now();
+        b.run();
+        auto t1 = clock::now();
+        std::clock_t c1 = std::clock();
+        realTotal += std::chrono::duration<double>(t1 - t0).count();
+        cpuTotal += double(c1 - c0) / CLOCKS_PER_SEC;
+        ++r.iterations;
+    }
+    r.realNs = realTotal / r.iterations * 1e9;
+    r.cpuNs = cpuTotal / r.iterations * 1e9;
+    if (b.itemsPerIteration > 0 && realTotal > 0) r.itemsPerSecond = double(b.itemsPerIteration) * r.iterations / realTotal;
+    return r;
+}
+
+std::string jsonEscape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) { char buf[8]; std::snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+        else out += c;
+    }
+    return out;
+}
+
+void writeJson(const std::vector<Result> &results, const std::string &path, const std::string &executable) {
+    std::ofstream f(path);
+    std::time_t now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    f << "{\n  \"context\": {\n";
+    f << "    \"date\": \"" << date << "\",\n";
+    f << "    \"executable\": \"" << jsonEscape(executable) << "\",\n";
+    f << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    f << "    \"library_build_type\": \"release\"\n";
+#else
+    f << "    \"library_build_type\": \"debug\"\n";
+#endif
+    f << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        f << "    {\"name\": \"" << jsonEscape(r.name) << "\", \"run_name\": \"" << jsonEscape(r.name)
+          << "\", \"run_type\": \"iteration\", \"iterations\": " << r.iterations
+          << ", \"real_time\": " << r.realNs << ", \"cpu_time\": " << r.cpuNs << ", \"time_unit\": \"ns\"";
+        if (r.itemsPerSecond > 0) f << ", \"items_per_second\": " << r.itemsPerSecond;
+        f << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    f << "  ]\n}\n";
+}
+
+void removeDb(const std::string &path) {
+    std::error_code ec;
+    fs::remove(path, ec);
+    fs::remove(path + ".wal", ec);
+}
+
+// Everything the benchmarks of one corpus size share
+struct Fixture {
+    size_t size = 0;
+    fs::path dir;
+    std::vector<Item> items;
+    std::string bibPath, rdfPath, endnotePath, mendeleyPath, dbPath;
+    std::unique_ptr<Database> db;           // populated with `items`
+    std::vector<Item> doiTargets, isbnTargets, titleTargets;
+    std::string collectionRoot;
+};
+
+std::unique_ptr<Fixture> makeFixture(size_t size, uint64_t seed, const fs::path &root) {
+    auto fx = std::make_unique<Fixture>();
+    fx->size = size;
+    fx->dir = root / ("n" + std::to_string(size));
+    fs::create_directories(fx->dir);
+    CorpusOptions opts;
+    opts.items = size;
+    opts.seed = seed;
+    SyntheticCorpus corpus(opts);
+    fx->items = corpus.makeItems();
+    fx->bibPath = (fx->dir / "corpus.bib").string();
+    fx->rdfPath = (fx->dir / "corpus.rdf").string();
+    fx->endnotePath = (fx->dir / "corpus-endnote.xml").string();
+    fx->mendeleyPath = (fx->dir / "corpus-mendeley.xml").string();
+    SyntheticCorpus::writeBibTeX(fx->items, fx->bibPath);
+    SyntheticCorpus::writeZoteroRDF(fx->items, fx->rdfPath);
+    SyntheticCorpus::writeEndNoteXML(fx->items, fx->endnotePath);
+    SyntheticCorpus::writeMendeleyXML(fx->items, fx->mendeleyPath);
+
+    fx->dbPath = (fx->dir / "library.db").string();
+    removeDb(fx->dbPath);
+    fx->db = std::make_unique<Database>(fx->dbPath);
+    fx->db->init();
+    fx->db->addItems(fx->items);
+
+    // Lookup targets spread across the corpus
+    const size_t step = std::max<size_t>(1, size / 100);
+    for (size_t i = 0; i < size; i += step) {
+        const Item &it = fx->items[i];
+        if (!it.doi.empty() && fx->doiTargets.size() < 100) fx->doiTargets.push_back(it);
+        if (!it.isbn.empty() && fx->isbnTargets.size() < 100) fx->isbnTargets.push_back(it);
+        if (fx->titleTargets.size() < 100) fx->titleTargets.push_back(it);
+    }
+    if (!fx->items.empty()) {
+        const std::string &c = fx->items.front().collection;
+        fx->collectionRoot = c.substr(0, c.find('/'));
+    }
+    return fx;
+}
+
+std::vector<Benchmark> benchmarksFor(Fixture &fx) {
+    std::vector<Benchmark> out;
+    const std::string n = "/" + std::to_string(fx.size);
+    const int64_t size = (int64_t)fx.size;
+
+    auto parser = [&](const std::string &name, std::vector<Item> (*parse)(const QString &), const std::string &path) {
+        out.push_back({"parse/" + name + n, size, nullptr, [parse, path]() {
+            auto items = parse(QString::fromStdString(path));
+            if (items.empty()) std::cerr << "warning: parser returned no items for " << path << "\n";
+        }});
+    };
+    parser("bibtex", &parseBibTeXFile, fx.bibPath);
+    parser("zotero_rdf", &parseZoteroRDFFile, fx.rdfPath);
+    parser("endnote_xml", &parseEndNoteXMLFile, fx.endnotePath);
+    parser("mendeley_xml", &parseMendeleyXMLFile, fx.mendeleyPath);
+
+    // Row-at-a-time inserts are slow enough that large sizes are capped
+    auto scratch = std::make_shared<std::unique_ptr<Database>>();
+    const std::string scratchPath = (fx.dir / "scratch.db").string();
+    auto freshDb = [scratch, scratchPath]() {
+        scratch->reset();
+        removeDb(scratchPath);
+        *scratch = std::make_unique<Database>(scratchPath);
+        (*scratch)->init();
+    };
+    const size_t addItemCount = std::min<size_t>(fx.size, 10000);
+    out.push_back({"db/addItem" + n, (int64_t)addItemCount, freshDb, [&fx, scratch, addItemCount]() {
+        for (size_t i = 0; i < addItemCount; ++i) (*scratch)->addItem(fx.items[i]);
+    }});
+    out.push_back({"db/addItems" + n, size, freshDb, [&fx, scratch]() { (*scratch)->addItems(fx.items); }});
+
+    out.push_back({"db/listItems" + n, size, nullptr, [&fx]() { fx.db->listItems(); }});
+    out.push_back({"db/listItemsInCollection" + n, 0, nullptr, [&fx]() { fx.db->listItemsInCollection(fx.collectionRoot); }});
+    out.push_back({"db/findItemByDOI" + n, (int64_t)fx.doiTargets.size(), nullptr, [&fx]() {
+        Item found;
+        for (const auto &t : fx.doiTargets) fx.db->findItemByDOI(t.doi, found);
+    }});
+    out.push_back({"db/findItemByISBN" + n, (int64_t)fx.isbnTargets.size(), nullptr, [&fx]() {
+        Item found;
+        for (const auto &t : fx.isbnTargets) fx.db->findItemByISBN(t.isbn, found);
+    }});
+    out.push_back({"db/findItemByTitleAndAuthor" + n, (int64_t)fx.titleTargets.size(), nullptr, [&fx]() {
+        Item found;
+        for (const auto &t : fx.titleTargets) fx.db->findItemByTitleAndAuthor(t.title, t.authors, found);
+    }});
+    out.push_back({"db/findExistingItems" + n, (int64_t)fx.titleTargets.size(), nullptr, [&fx]() {
+        fx.db->findExistingItems(fx.titleTargets);
+    }});
+
+    // Full MinHash/LSH index build plus candidate search on a library nobody has scanned yet
+    out.push_back({"dedupe/findDuplicateClusters" + n, size, [&fx, freshDb, scratch]() {
+        freshDb();
+        (*scratch)->addItems(fx.items);
+    }, [scratch]() {
+        if ((*scratch)->findDuplicateClusters().empty()) std::cerr << "warning: no duplicate clusters found\n";
+    }});
+
+    out.push_back({"export/itemToBibTeX" + n, size, nullptr, [&fx]() {
+        qsizetype total = 0;
+        for (const auto &it : fx.items) total += itemToBibTeX(it, 1).size();
+        if (total == 0) std::cerr << "warning: empty BibTeX export\n";
+    }});
+    out.push_back({"export/exportBibTeX" + n, size, nullptr, [&fx]() {
+        ItemQuery q;
+        q.limit = 0;
+        qsizetype total = 0;
+        exportBibTeX(*fx.db, q, BibTeXExporter(1), [&total](const QByteArray &block) { total += block.size(); });
+        if (total == 0) std::cerr << "warning: empty streamed BibTeX export\n";
+    }});
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<size_t> sizes = {1000, 100000};
+    std::string filter, outPath;
+    double minSeconds = 1.0;
+    uint64_t seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&](const char *flag) { return a.substr(std::string(flag).size()); };
+        if (a.rfind("--sizes=", 0) == 0) {
+            sizes.clear();
+            std::stringstream ss(value("--sizes="));
+            std::string tok;
+            while (std::getline(ss, tok, ',')) if (!tok.empty()) sizes.push_back(std::stoull(tok));
+        } else if (a.rfind("--filter=", 0) == 0) filter = value("--filter=");
+        else if (a.rfind("--min-time=", 0) == 0) minSeconds = std::stod(value("--min-time="));
+        else if (a.rfind("--seed=", 0) == 0) seed = std::stoull(value("--seed="));
+        else if (a.rfind("--out=", 0) == 0) outPath = value("--out=");
+        else {
+            std::cerr << "usage: bello_bench [--sizes=1000,100000,1000000] [--filter=substring] "
+                         "[--min-time=seconds] [--seed=N] [--out=results.json]\n";
+            return a == "--help" ? 0 : 2;
+        }
+    }
+
+    // Keep parser side effects (storage directories under $HOME) out of the user's profile
+    const fs::path root = fs::temp_directory_path() / ("bello_bench_" + std::to_string(seed));
+    fs::create_directories(root);
+    qputenv("HOME", QByteArray::fromStdString(root.string()));
+
+    std::vector<Result> results;
+    std::printf("%-44s %14s %14s %10s %16s\n", "Benchmark", "Time (ms)", "CPU (ms)", "Iters", "items/s");
+    for (size_t size : sizes) {
+        std::cerr << "preparing corpus of " << size << " items...\n";
+        auto fx = makeFixture(size, seed, root);
+        for (const Benchmark &b : benchmarksFor(*fx)) {
+            if (!filter.empty() && b.name.find(filter) == std::string::npos) continue;
+            Result r = runBenchmark(b, minSeconds);
+            std::printf("%-44s %14.3f %14.3f %10lld %16.0f\n", r.name.c_str(), r.realNs / 1e6, r.cpuNs / 1e6,
+                        (long long)r.iterations, r.itemsPerSecond);
+            std::fflush(stdout);
+            results.push_back(r);
+        }
+    }
+    if (!outPath.empty()) writeJson(results, outPath, argv[0]);
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return 0;
+}
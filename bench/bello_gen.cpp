@@ -0,0 +1,164 @@
+// bello_gen: writes seeded synthetic libraries for load testing.
+//
+//   bello_gen --format=bib|rdf|endnote|mendeley|db --out=PATH [--items=1000000]
+//             [--seed=42] [--collections=2000] [--max-depth=8] [--nest-rate=0.5]
+//             [--title-words=4:14] [--abstract-words=60:250] [--authors=1:5]
+//             [--abstract-rate=0.5] [--duplicate-rate=0.02]
+//             [--multi-membership=0.1] [--max-memberships=3]
+//             [--pdf-rate=0.2 --pdf-dir=DIR [--pdf-kb=200]]
+//
+// The same flags always produce the same library. Items are generated and
+// written in batches, so a million-item corpus never sits in memory at once.
+// With --format=db the items go straight into a fresh DuckDB file through the
+// bulk Database API, including extra collection memberships.
+
+#include "Database.h"
+#include "SyntheticCorpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t kBatchSize = 10000;
+
+bool parseRange(const std::string &v, int &lo, int &hi) {
+    auto colon = v.find(':');
+    if (colon == std::string::npos) return false;
+    lo = std::stoi(v.substr(0, colon));
+    hi = std::stoi(v.substr(colon + 1));
+    return lo >= 0 && hi >= lo;
+}
+
+int usage(int code) {
+    std::cerr << "usage: bello_gen --format=bib|rdf|endnote|mendeley|db --out=PATH [--items=N] [--seed=N]\n"
+                 "                 [--collections=N] [--max-depth=N] [--nest-rate=P]\n"
+                 "                 [--title-words=MIN:MAX] [--abstract-words=MIN:MAX] [--authors=MIN:MAX]\n"
+                 "                 [--abstract-rate=P] [--duplicate-rate=P] [--multi-membership=P] [--max-memberships=N]\n"
+                 "                 [--pdf-rate=P --pdf-dir=DIR] [--pdf-kb=N]\n";
+    return code;
+}
+
+void progress(size_t done, size_t total) {
+    std::cerr << "\r" << done << " / " << total << " items" << std::flush;
+    if (done == total) std::cerr << "\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    CorpusOptions opts;
+    opts.items = 1000000;
+    std::string format, outPath;
+    size_t pdfKb = 200;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto eq = a.find('=');
+            std::string flag = a.substr(0, eq);
+            std::string v = eq == std::string::npos ? std::string() : a.substr(eq + 1);
+            bool ok = true;
+            if (flag == "--format") format = v;
+            else if (flag == "--out") outPath = v;
+            else if (flag == "--items") opts.items = std::stoull(v);
+            else if (flag == "--seed") opts.seed = std::stoull(v);
+            else if (flag == "--collections") opts.collections = std::stoi(v);
+            else if (flag == "--max-depth") opts.maxDepth = std::stoi(v);
+            else if (flag == "--nest-rate") opts.nestRate = std::stod(v);
+            else if (flag == "--title-words") ok = parseRange(v, opts.titleWordsMin, opts.titleWordsMax);
+            else if (flag == "--abstract-words") ok = parseRange(v, opts.abstractWordsMin, opts.abstractWordsMax);
+            else if (flag == "--authors") ok = parseRange(v, opts.authorsMin, opts.authorsMax);
+            else if (flag == "--abstract-rate") opts.abstractRate = std::stod(v);
+            else if (flag == "--duplicate-rate") opts.duplicateRate = std::stod(v);
+            else if (flag == "--multi-membership") opts.extraMembershipRate = std::stod(v);
+            else if (flag == "--max-memberships") opts.maxExtraMemberships = std::stoi(v);
+            else if (flag == "--pdf-rate") opts.pdfRate = std::stod(v);
+            else if (flag == "--pdf-dir") opts.pdfDir = v;
+            else if (flag == "--pdf-kb") pdfKb = std::stoull(v);
+            else if (flag == "--help") return usage(0);
+            else ok = false;
+            if (!ok) {
+                std::cerr << "bad argument: " << a << "\n";
+                return usage(2);
+            }
+        }
+    } catch (std::exception &) {
+        std::cerr << "bad numeric argument\n";
+        return usage(2);
+    }
+    if (format.empty() || outPath.empty()) return usage(2);
+    if (opts.pdfRate > 0 && opts.pdfDir.empty()) {
+        std::cerr << "--pdf-rate needs --pdf-dir\n";
+        return 2;
+    }
+    if (!opts.pdfDir.empty()) {
+        // Stored paths should not depend on where bello_gen was started
+        opts.pdfDir = fs::absolute(opts.pdfDir).string();
+        fs::create_directories(opts.pdfDir);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SyntheticCorpus corpus(opts);
+    size_t pdfs = 0;
+    auto withPdf = [&](const Item &it) {
+        if (SyntheticCorpus::writeFakePdf(it, pdfKb * 1024)) ++pdfs;
+    };
+
+    if (format == "db") {
+        std::error_code ec;
+        fs::remove(outPath, ec);
+        fs::remove(outPath + ".wal", ec);
+        Database db(outPath);
+        db.init();
+        std::vector<Item> batch;
+        std::vector<std::pair<std::string, std::string>> memberships;
+        for (size_t i = 0; i < opts.items; i += kBatchSize) {
+            size_t end = std::min(opts.items, i + kBatchSize);
+            batch.clear();
+            memberships.clear();
+            for (size_t j = i; j < end; ++j) {
+                batch.push_back(corpus.makeItem(j));
+                withPdf(batch.back());
+                for (auto &c : corpus.extraCollections(j)) memberships.emplace_back(batch.back().id, std::move(c));
+            }
+            db.addItems(batch);
+            db.addItemsToCollections(memberships);
+            progress(end, opts.items);
+        }
+    } else {
+        SyntheticCorpus::FileWriter::Format f;
+        if (format == "bib") f = SyntheticCorpus::FileWriter::BibTeX;
+        else if (format == "rdf") f = SyntheticCorpus::FileWriter::ZoteroRDF;
+        else if (format == "endnote") f = SyntheticCorpus::FileWriter::EndNoteXML;
+        else if (format == "mendeley") f = SyntheticCorpus::FileWriter::MendeleyXML;
+        else return usage(2);
+        SyntheticCorpus::FileWriter writer(outPath, f);
+        if (!writer.isOpen()) {
+            std::cerr << "cannot open " << outPath << "\n";
+            return 1;
+        }
+        for (size_t i = 0; i < opts.items; ++i) {
+            Item it = corpus.makeItem(i);
+            withPdf(it);
+            writer.write(it);
+            if ((i + 1) % kBatchSize == 0 || i + 1 == opts.items) progress(i + 1, opts.items);
+        }
+        if (!writer.close()) {
+            std::cerr << "write error on " << outPath << "\n";
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "wrote " << opts.items << " items in " << corpus.collectionPaths().size() << " collections";
+    if (pdfs) std::cerr << " and " << pdfs << " PDFs";
+    std::cerr << " to " << outPath << " in " << seconds << " s\n";
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "Attachments.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const qint64 kReadChunk = 1 << 20;
+
+// FNV-1a over the file's content; 0 if it cannot be read
+uint64_t fileHash(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    std::vector<char> buffer(kReadChunk);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    qint64 n;
+    while ((n = file.read(buffer.data(), kReadChunk)) > 0) {
+        for (qint64 i = 0; i < n; ++i) {
+            h ^= (unsigned char)buffer[i];
+            h *= 0x100000001b3ULL;
+        }
+    }
+    return n < 0 ? 0 : h;
+}
+
+} // namespace
+
+Attachment scanAttachment(const Attachment &previous) {
+    Attachment s;
+    s.itemId = previous.itemId;
+    s.ordinal = previous.ordinal;
+    s.path = previous.path;
+    s.scanned = true;
+    const QString path = QString::fromStdString(previous.path);
+    const QFileInfo fi(path);
+    s.present = fi.isFile();
+    if (!s.present) return s;
+    s.size = fi.size();
+    s.mtime = fi.lastModified().toMSecsSinceEpoch();
+    if (previous.scanned && previous.present && previous.hash && previous.size == s.size && previous.mtime == s.mtime) {
+        s.hash = previous.hash;
+        s.mime = previous.mime;
+    } else {
+        s.hash = fileHash(path);
+        s.mime = QMimeDatabase().mimeTypeForFile(fi).name().toStdString();
+    }
+    return s;
+}
+
+std::vector<std::string> splitAttachmentPaths(const std::string &pdfPath) {
+    std::vector<std::string> paths;
+    size_t start = 0;
+    while (start <= pdfPath.size()) {
+        size_t end = pdfPath.find(';', start);
+        if (end == std::string::npos) end = pdfPath.size();
+        std::string p = pdfPath.substr(start, end - start);
+        start = end + 1;
+        const size_t b = p.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos) continue;
+        p = p.substr(b, p.find_last_not_of(" \t\r\n") - b + 1);
+        if (std::find(paths.begin(), paths.end(), p) == paths.end()) paths.push_back(std::move(p));
+    }
+    return paths;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Database.h"
+
+// Attachment integrity: the database keeps each attachment file's existence,
+// size, mtime, content hash and MIME type (Database::getAttachments), so the UI
+// never stats files itself. The GUI rescans in the background, on a low-priority
+// thread, the paths Database::listAttachmentsToScan returns, and marks a
+// directory for rescanning when a QFileSystemWatcher reports a change in it.
+// No QtWidgets dependency.
+
+// Stat `previous.path`. The content is hashed and its type detected again only when
+// the size or mtime differ from `previous`, so rescanning an unchanged file costs one stat.
+Attachment scanAttachment(const Attachment &previous);
+
+// The paths of a ';'-joined Item::pdf_path, trimmed, without blanks or repeats
+std::vector<std::string> splitAttachmentPaths(const std::string &pdfPath);
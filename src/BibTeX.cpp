@@ -0,0 +1,161 @@
+#include "BibTeX.h"
+#include "CiteKey.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+// Item member written under each BibTeX field name. Some fields are stored in a
+// shared column (institution and school in publisher, booktitle in journal).
+struct FieldSpec {
+    const char *name;
+    std::string Item::*member;
+};
+
+constexpr FieldSpec kAuthor{"author", &Item::authors};
+constexpr FieldSpec kTitle{"title", &Item::title};
+constexpr FieldSpec kJournal{"journal", &Item::journal};
+constexpr FieldSpec kYear{"year", &Item::year};
+constexpr FieldSpec kVolume{"volume", &Item::volume};
+constexpr FieldSpec kNumber{"number", &Item::number};
+constexpr FieldSpec kPages{"pages", &Item::pages};
+constexpr FieldSpec kDoi{"doi", &Item::doi};
+constexpr FieldSpec kIsbn{"isbn", &Item::isbn};
+constexpr FieldSpec kPublisher{"publisher", &Item::publisher};
+constexpr FieldSpec kAddress{"address", &Item::address};
+constexpr FieldSpec kInstitution{"institution", &Item::publisher};
+constexpr FieldSpec kBooktitle{"booktitle", &Item::journal};
+constexpr FieldSpec kSchool{"school", &Item::publisher};
+constexpr FieldSpec kHowpublished{"howpublished", &Item::url};
+constexpr FieldSpec kUrl{"url", &Item::url};
+constexpr FieldSpec kAbstract{"abstract", &Item::abstract};
+constexpr FieldSpec kKeywords{"keywords", &Item::keywords};
+constexpr FieldSpec kNote{"note", &Item::note};
+
+// Canonical field order per entry type. series, edition and month used to be
+// listed too but were never written; they stay out so output is unchanged.
+constexpr FieldSpec kArticleOrder[] = {kAuthor, kTitle, kJournal, kYear, kVolume, kNumber, kPages, kDoi, kUrl, kAbstract, kKeywords, kNote};
+constexpr FieldSpec kBookOrder[] = {kAuthor, kTitle, kPublisher, kAddress, kYear, kVolume, kIsbn, kUrl, kAbstract, kKeywords, kNote};
+constexpr FieldSpec kProceedingsOrder[] = {kAuthor, kTitle, kBooktitle, kYear, kPages, kPublisher, kAddress, kDoi, kUrl, kAbstract, kKeywords, kNote};
+constexpr FieldSpec kReportOrder[] = {kAuthor, kTitle, kInstitution, kYear, kNumber, kAddress, kUrl, kNote};
+constexpr FieldSpec kThesisOrder[] = {kAuthor, kTitle, kSchool, kYear, kAddress, kNote, kUrl};
+constexpr FieldSpec kMiscOrder[] = {kAuthor, kTitle, kHowpublished, kYear, kNote, kUrl, kDoi, kIsbn, kAbstract, kKeywords};
+
+struct FieldOrder {
+    const FieldSpec *begin;
+    const FieldSpec *end;
+};
+
+template <size_t N>
+constexpr FieldOrder orderOf(const FieldSpec (&fields)[N]) { return {fields, fields + N}; }
+
+FieldOrder fieldOrderFor(const std::string &type) {
+    if (type == "article") return orderOf(kArticleOrder);
+    if (type == "book") return orderOf(kBookOrder);
+    if (type == "inproceedings" || type == "conference") return orderOf(kProceedingsOrder);
+    if (type == "techreport") return orderOf(kReportOrder);
+    if (type == "phdthesis" || type == "mastersthesis") return orderOf(kThesisOrder);
+    return orderOf(kMiscOrder);
+}
+
+char asciiLower(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+
+void appendField(QByteArray &out, bool &first, const char *name, const char *value, qsizetype size) {
+    out += first ? "  " : ",\n  ";
+    out += name;
+    out += " = {";
+    out.append(value, size);
+    out += '}';
+    first = false;
+}
+
+} // namespace
+
+std::string BibTeXExporter::citationKey(const Item &it) const {
+    if (keyPref == 2) {
+        // prefer DOI or ISBN
+        std::string key = citeKeyFromIdentifier(it);
+        if (!key.empty()) return key;
+    }
+    // the database keeps a unique author_title_year key; items that never went
+    // through it (parsed files, tests) get the undisambiguated base
+    if (!it.citekey.empty()) return it.citekey;
+    return citeKeyBase(it);
+}
+
+void BibTeXExporter::append(const Item &it, QByteArray &out) const {
+    std::string type = it.type;
+    bool ascii = std::all_of(type.begin(), type.end(), [](char c) { return (unsigned char)c < 0x80; });
+    if (ascii) std::transform(type.begin(), type.end(), type.begin(), asciiLower);
+    else type = QString::fromStdString(type).toLower().toStdString();
+    if (type.empty()) type = "misc";
+
+    out += '@';
+    out.append(type.data(), type.size());
+    out += '{';
+    const std::string key = citationKey(it);
+    out.append(key.data(), key.size());
+    out += ",\n";
+
+    bool first = true;
+    const FieldOrder order = fieldOrderFor(type);
+    for (const FieldSpec *f = order.begin; f != order.end; ++f) {
+        const std::string &v = it.*(f->member);
+        if (!v.empty()) appendField(out, first, f->name, v.data(), v.size());
+    }
+
+    // Extra JSON fields, in key order
+    if (!it.extra.empty()) {
+        QJsonDocument d = QJsonDocument::fromJson(QByteArray::fromStdString(it.extra));
+        if (d.isObject()) {
+            const QJsonObject obj = d.object();
+            QStringList keys = obj.keys();
+            std::sort(keys.begin(), keys.end());
+            for (const QString &k : keys) {
+                const QJsonValue v = obj.value(k);
+                const QByteArray name = k.toUtf8();
+                const QByteArray value = v.isString() ? v.toString().toUtf8()
+                                                      : QJsonDocument(v.toObject()).toJson(QJsonDocument::Compact);
+                appendField(out, first, name.constData(), value.constData(), value.size());
+            }
+        }
+    }
+    if (!first) out += '\n';
+    out += '}';
+}
+
+QString BibTeXExporter::format(const Item &it) const {
+    QByteArray out;
+    append(it, out);
+    return QString::fromUtf8(out);
+}
+
+BibTeXWriter::BibTeXWriter(const BibTeXExporter &exporter, Sink sink, qsizetype flushBytes)
+    : exporter(exporter), sink(std::move(sink)), flushBytes(flushBytes) {
+    buffer.reserve(flushBytes + 4096);
+}
+
+void BibTeXWriter::write(const Item &it) {
+    if (written) buffer += "\n\n";
+    exporter.append(it, buffer);
+    ++written;
+    if (buffer.size() >= flushBytes) flush();
+}
+
+void BibTeXWriter::flush() {
+    if (buffer.isEmpty()) return;
+    if (sink) sink(buffer);
+    buffer.truncate(0); // keeps the allocation for the next block
+}
+
+size_t exportBibTeX(Database &db, const ItemQuery &q, const BibTeXExporter &exporter, const BibTeXWriter::Sink &sink) {
+    BibTeXWriter writer(exporter, sink);
+    db.queryItems(q, [&](const std::vector<Item> &chunk) {
+        for (const auto &it : chunk) writer.write(it);
+    });
+    writer.flush();
+    return writer.count();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Database.h"
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+
+// BibTeX formatting of Items, usable without the GUI. Construct once per export
+// (or keep one around) and reuse it: the key preference is read by the caller a
+// single time and entries are appended straight into a caller-owned buffer.
+class BibTeXExporter {
+public:
+    // keyPref selects the citation key: 1 = author_title_year, 2 = DOI or ISBN when
+    // present (the "export/bibkey" setting). Items read from the database carry
+    // their stored unique key (Item::citekey), which is used instead of deriving one.
+    explicit BibTeXExporter(int keyPref = 1) : keyPref(keyPref) {}
+
+    void setKeyPreference(int pref) { keyPref = pref; }
+    int keyPreference() const { return keyPref; }
+
+    // Append one entry as UTF-8, without a trailing newline
+    void append(const Item &it, QByteArray &out) const;
+    QString format(const Item &it) const;
+    std::string citationKey(const Item &it) const;
+
+private:
+    int keyPref;
+};
+
+inline QString itemToBibTeX(const Item &it, int keyPref) { return BibTeXExporter(keyPref).format(it); }
+
+// Collects formatted entries in a UTF-8 buffer and passes it to `sink` in large
+// blocks, so exports of any size go to a file or the clipboard without holding
+// per-entry strings.
+class BibTeXWriter {
+public:
+    using Sink = std::function<void(const QByteArray&)>;
+    explicit BibTeXWriter(const BibTeXExporter &exporter, Sink sink, qsizetype flushBytes = 1 << 20);
+    ~BibTeXWriter() { flush(); }
+
+    void write(const Item &it);   // entries are separated by a blank line
+    void flush();
+    size_t count() const { return written; }
+
+private:
+    const BibTeXExporter &exporter;
+    Sink sink;
+    qsizetype flushBytes;
+    QByteArray buffer;
+    size_t written = 0;
+};
+
+// Stream every item matching `q` (ordered by title) through a BibTeXWriter.
+// Returns the number of entries written.
+size_t exportBibTeX(Database &db, const ItemQuery &q, const BibTeXExporter &exporter, const BibTeXWriter::Sink &sink);
@@ -7,14 +7,28 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QByteArray>
+#include <QHash>
+#include <QSet>
 #include <QList>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include "UUID.h"
 #include "Database.h"
+#include "Attachments.h"
+#include "Dedupe.h"
+#include "Identifiers.h"
+#include "Metrics.h"
+#include "Compression.h"
 
 class BrowserConnector : public QObject {
 public:
@@ -28,48 +42,84 @@ public:
             qDebug("Connector server listening on port %d", connectorPort);
         }
 
+        // Library changes feed /connector/events; see queueChange() for coalescing
+        eventFlushTimer = new QTimer(this);
+        eventFlushTimer->setSingleShot(true);
+        connect(eventFlushTimer, &QTimer::timeout, this, [this]() { flushEvents(); });
+        eventKeepAliveTimer = new QTimer(this);
+        eventKeepAliveTimer->setInterval(20000);
+        connect(eventKeepAliveTimer, &QTimer::timeout, this, [this]() { broadcastEvent(": ping\n\n"); });
+        this->db->addChangeListener([this](const DbChange &c) { queueChange(c); });
+
         connect(server, &QTcpServer::newConnection, this, [this]() {
             while (server->hasPendingConnections()) {
                 QTcpSocket *socket = server->nextPendingConnection();
-                
-                // Use a shared buffer to accumulate data for large requests
-                auto buffer = std::make_shared<QByteArray>();
-                auto processed = std::make_shared<bool>(false);
-                
-                connect(socket, &QTcpSocket::readyRead, this, [this, socket, buffer, processed]() {
-                    if (*processed) return; // Already handled this request
-                    
-                    buffer->append(socket->readAll());
-                    
-                    // Check if we have headers yet
-                    const QByteArray sep = "\r\n\r\n";
-                    int idx = buffer->indexOf(sep);
-                    if (idx == -1) return; // wait for headers
-                    
-                    // Parse Content-Length from headers
-                    QByteArray header = buffer->left(idx);
-                    int contentLength = 0;
-                    QList<QByteArray> headerLines = header.split('\n');
-                    for (const QByteArray &line : headerLines) {
-                        if (line.toLower().startsWith("content-length:")) {
-                            contentLength = line.mid(15).trimmed().toInt();
-                            break;
+
+                // Per-connection state: the request is accumulated across readyRead calls
+                auto req = std::make_shared<PendingRequest>();
+
+                connect(socket, &QTcpSocket::readyRead, this, [this, socket, req]() {
+                    if (req->processed) return; // Already handled this request
+
+                    QByteArray data = socket->readAll();
+                    req->wireBytes += data.size();
+
+                    if (req->contentLength < 0) {
+                        // Check if we have headers yet
+                        req->head.append(data);
+                        const QByteArray sep = "\r\n\r\n";
+                        int idx = req->head.indexOf(sep);
+                        if (idx == -1) return; // wait for headers
+                        req->header = req->head.left(idx);
+                        data = req->head.mid(idx + sep.size());
+                        req->head.clear();
+                        req->contentLength = qMax<qint64>(0, headerValue(req->header, "Content-Length").toLongLong());
+
+                        // Compressed bodies are inflated as they arrive instead of being buffered whole
+                        const QByteArray encoding = headerValue(req->header, "Content-Encoding").toLower();
+                        if (kHaveCompression && (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate")) {
+                            req->inflater = std::make_unique<Inflater>(kMaxInflatedBodyBytes);
+                        } else if (!encoding.isEmpty() && encoding != "identity") {
+                            req->processed = true;
+                            sendJson(socket, "415 Unsupported Media Type", "{\"success\":false,\"error\":\"unsupported content encoding\"}");
+                            return;
                         }
                     }
-                    
+
                     // Check if we have the complete body
-                    int bodyStart = idx + sep.size();
-                    int receivedBody = buffer->size() - bodyStart;
-                    if (receivedBody < contentLength) {
-                        // Wait for more data
-                        std::cerr << "  waiting for more data: have " << receivedBody << " of " << contentLength << std::endl;
-                        return;
+                    data.truncate(req->contentLength - req->received);
+                    req->received += data.size();
+                    if (req->inflater) {
+                        Inflater::Status st = req->inflater->feed(data.constData(), data.size());
+                        if (st == Inflater::Error || st == Inflater::TooLarge) {
+                            req->processed = true;
+                            if (st == Inflater::TooLarge) sendJson(socket, "413 Payload Too Large", "{\"success\":false,\"error\":\"decompressed body too large\"}");
+                            else sendJson(socket, "400 Bad Request", "{\"success\":false,\"error\":\"corrupt compressed body\"}");
+                            return;
+                        }
+                    } else {
+                        req->body.append(data);
+                    }
+                    if (req->received < req->contentLength) return; // wait for more data
+                    if (req->inflater) {
+                        if (req->contentLength > 0 && !req->inflater->isFinished()) {
+                            req->processed = true;
+                            sendJson(socket, "400 Bad Request", "{\"success\":false,\"error\":\"truncated compressed body\"}");
+                            return;
+                        }
+                        req->body = std::move(req->inflater->output());
+                        req->inflater.reset();
                     }
-                    
-                    *processed = true; // Mark as processed to avoid re-entry
-                    
+
+                    req->processed = true; // Mark as processed to avoid re-entry
+                    metrics.requests.fetch_add(1, std::memory_order_relaxed);
+                    metrics.requestBytes.observe(req->wireBytes);
+                    ScopedTimer requestTimer(metrics.requestSeconds);
+
                     // We have the complete request - process it
-                    QByteArray body = buffer->mid(bodyStart, contentLength);
+                    const QByteArray &header = req->header;
+                    const QByteArray &body = req->body;
+                    const QByteArray responseEncoding = negotiateEncoding(headerValue(header, "Accept-Encoding"));
                     QList<QByteArray> lines = header.split('\n');
                     QByteArray reqLine = lines.size() ? lines[0].trimmed() : QByteArray();
                     QList<QByteArray> parts = reqLine.split(' ');
@@ -80,225 +130,37 @@ public:
                     if (method == "GET" && path == "/connector/status") {
                         QJsonObject obj; obj["version"] = "1.0.0";
                         QJsonDocument doc(obj); QByteArray out = doc.toJson(QJsonDocument::Compact);
-                        QByteArray resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(out.size()) + "\r\n\r\n" + out;
-                        socket->write(resp); socket->flush(); socket->disconnectFromHost(); return;
+                        sendJson(socket, "200 OK", out); return;
+                    }
+
+                    if (method == "GET" && path == "/connector/metrics") {
+                        sendResponse(socket, "200 OK", "text/plain; version=0.0.4", QByteArray::fromStdString(metrics.render()), responseEncoding);
+                        return;
+                    }
+
+                    if (method == "GET" && path == "/connector/events") {
+                        handleEvents(socket);
+                        return;
                     }
 
                     if (method == "GET" && path.startsWith("/connector/items")) {
-                        int qidx = path.indexOf('?');
-                        int limit = 50;
-                        if (qidx != -1) {
-                            QByteArray qs = path.mid(qidx+1);
-                            QList<QByteArray> parts = qs.split('&');
-                            for (const QByteArray &p : parts) {
-                                QList<QByteArray> kv = p.split('=');
-                                if (kv.size() == 2 && kv[0] == "limit") {
-                                    bool ok = false; int v = kv[1].toInt(&ok);
-                                    if (ok && v > 0 && v <= 1000) limit = v;
-                                }
-                            }
-                        }
-                        QJsonArray arr;
-                        auto items = this->db->listItems();
-                        int count = 0;
-                        for (const auto &it : items) {
-                            if (count++ >= limit) break;
-                            QJsonObject o;
-                            o["id"] = QString::fromStdString(it.id);
-                            o["title"] = QString::fromStdString(it.title);
-                            o["authors"] = QString::fromStdString(it.authors);
-                            o["year"] = QString::fromStdString(it.year);
-                            o["doi"] = QString::fromStdString(it.doi);
-                            o["url"] = QString::fromStdString(it.url);
-                            o["collection"] = QString::fromStdString(it.collection);
-                            arr.append(o);
-                        }
-                        QJsonDocument doc(arr); QByteArray out = doc.toJson(QJsonDocument::Compact);
-                        QByteArray resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(out.size()) + "\r\n\r\n" + out;
-                        socket->write(resp); socket->flush(); socket->disconnectFromHost(); return;
+                        handleItems(socket, header, path, responseEncoding);
+                        return;
                     }
 
                     if (method == "POST" && path == "/connector/save") {
-                        std::cerr << "=== BrowserConnector: POST /connector/save ===" << std::endl;
-                        std::cerr << "  body length: " << body.size() << std::endl;
-                        
-                        QJsonParseError err; QJsonDocument reqDoc = QJsonDocument::fromJson(body, &err);
-                        std::cerr << "  JSON parse error: " << err.errorString().toStdString() << " at offset " << err.offset << std::endl;
-                        std::cerr << "  reqDoc.isNull: " << (reqDoc.isNull() ? "yes" : "no") << std::endl;
-                        std::cerr << "  reqDoc.isObject: " << (reqDoc.isObject() ? "yes" : "no") << std::endl;
-                        
-                        bool ok = false; std::string createdId;
-                        if (!reqDoc.isNull() && err.error == QJsonParseError::NoError && reqDoc.isObject()) {
-                            QJsonObject root = reqDoc.object();
-                            QJsonObject data = root.value("data").toObject();
-                            std::cerr << "  data keys: ";
-                            for (const QString &k : data.keys()) std::cerr << k.toStdString() << " ";
-                            std::cerr << std::endl;
-                            
-                            // First, check if this is an update to an existing item
-                            std::string incomingDoi = data.value("doi").toString().toStdString();
-                            std::string incomingIsbn = data.value("isbn").toString().toStdString();
-                            std::string incomingTitle = data.value("title").toString().toStdString();
-                            std::string incomingAuthors = data.value("authors").toString().toStdString();
-                            
-                            Item existing; bool found = false;
-                            if (!incomingDoi.empty()) found = this->db->findItemByDOI(incomingDoi, existing);
-                            if (!found && !incomingIsbn.empty()) found = this->db->findItemByISBN(incomingIsbn, existing);
-                            if (!found && !incomingTitle.empty() && !incomingAuthors.empty()) found = this->db->findItemByTitleAndAuthor(incomingTitle, incomingAuthors, existing);
-                            
-                            // Determine which ID to use for storage
-                            std::string storageId = found ? existing.id : gen_uuid();
-                            
-                            Item it;
-                            it.id = storageId;
-                            it.title = incomingTitle;
-                            it.authors = incomingAuthors;
-                            it.year = data.value("year").toString().toStdString();
-                            QString incomingType = data.value("type").toString();
-                            QString incomingBibtex = data.value("bibtexType").toString();
-                            it.type = incomingType.toStdString();
-                            if ((it.type.empty() || incomingBibtex.size() > 0) && !incomingBibtex.isEmpty()) it.type = incomingBibtex.toStdString();
-                            it.doi = incomingDoi;
-                            it.isbn = incomingIsbn;
-                            it.publisher = data.value("publisher").toString().toStdString();
-                            it.pages = data.value("pages").toString().toStdString();
-                            it.volume = data.value("volume").toString().toStdString();
-                            it.number = data.value("number").toString().toStdString();
-                            it.journal = data.value("journal").toString().toStdString();
-                            it.url = data.value("url").toString().toStdString();
-                            it.abstract = data.value("abstract").toString().toStdString();
-                            it.pdf_path = data.value("pdf_path").toString().toStdString();
-                            
-                            // Debug: Log what we received
-                            std::cerr << "BrowserConnector: received request" << std::endl;
-                            std::cerr << "  doi: " << incomingDoi << std::endl;
-                            std::cerr << "  title: " << incomingTitle << std::endl;
-                            std::cerr << "  found existing: " << (found ? "yes" : "no") << std::endl;
-                            if (found) std::cerr << "  existing.id: " << existing.id << std::endl;
-                            std::cerr << "  storageId: " << storageId << std::endl;
-                            std::cerr << "  has attachments: " << (data.contains("attachments") ? "yes" : "no") << std::endl;
-                            
-                            // Handle attachments embedded as base64 in `data.attachments` (optional)
-                            if (data.contains("attachments") && data.value("attachments").isArray()) {
-                                QJsonArray a = data.value("attachments").toArray();
-                                std::cerr << "  attachments count: " << a.size() << std::endl;
-                                if (!a.isEmpty()) {
-                                    // Prepare storage directory: ~/.local/share/bello/storage/<item-id> (uses existing ID if updating)
-                                    QString home = QString::fromLocal8Bit(std::getenv("HOME"));
-                                    QString storageRoot = QDir::cleanPath(home + "/.local/share/bello/storage");
-                                    QDir().mkpath(storageRoot);
-                                    QString itemDir = storageRoot + "/" + QString::fromStdString(storageId);
-                                    std::cerr << "  storage dir: " << itemDir.toStdString() << std::endl;
-                                    QDir().mkpath(itemDir);
-                                    QStringList savedPaths;
-                                    for (int ai = 0; ai < a.size(); ++ai) {
-                                        QJsonValue v = a.at(ai);
-                                        if (!v.isObject()) continue;
-                                        QJsonObject o = v.toObject();
-                                        QString fname = o.value("filename").toString();
-                                        QString b64 = o.value("data").toString();
-                                        std::cerr << "  attachment " << ai << " filename: " << fname.toStdString() << " b64 length: " << b64.length() << std::endl;
-                                        if (b64.isEmpty() || fname.isEmpty()) continue;
-                                        QByteArray bytes = QByteArray::fromBase64(b64.toUtf8());
-                                        std::cerr << "  decoded bytes: " << bytes.size() << std::endl;
-                                        // Ensure unique filename
-                                        QString outPath = itemDir + "/" + fname;
-                                        QFile f(outPath);
-                                        int idx = 1;
-                                        while (f.exists()) {
-                                            QString stem = QFileInfo(fname).completeBaseName();
-                                            QString ext = QFileInfo(fname).suffix();
-                                            QString candidate = QString("%1_%2%3").arg(stem).arg(idx).arg(ext.isEmpty()?QString():QString('.' + ext));
-                                            outPath = itemDir + "/" + candidate;
-                                            f.setFileName(outPath);
-                                            ++idx;
-                                        }
-                                        std::cerr << "  writing to: " << outPath.toStdString() << std::endl;
-                                        if (f.open(QIODevice::WriteOnly)) {
-                                            f.write(bytes);
-                                            f.close();
-                                            savedPaths << outPath;
-                                            std::cerr << "  wrote successfully" << std::endl;
-                                        } else {
-                                            std::cerr << "  FAILED to open file for writing: " << f.errorString().toStdString() << std::endl;
-                                        }
-                                    }
-                                    if (!savedPaths.isEmpty()) {
-                                        // join saved paths with semicolon to match existing pdf_path format
-                                        QString joined = savedPaths.join(';');
-                                        if (it.pdf_path.empty()) it.pdf_path = joined.toStdString();
-                                        else {
-                                            std::string existingPdf = it.pdf_path;
-                                            existingPdf += ";" + joined.toStdString();
-                                            it.pdf_path = existingPdf;
-                                        }
-                                        std::cerr << "  pdf_path set to: " << it.pdf_path << std::endl;
-                                    }
-                                }
-                            }
-                            it.extra = data.value("extra").toString().toStdString();
-
-                            std::string coll = data.value("collection").toString().toStdString();
-                            it.collection = coll;
-
-                            // Use the 'found' and 'existing' from earlier lookup
-                            if (found) {
-                                std::cerr << "Merging with existing item: " << existing.id << std::endl;
-                                std::cerr << "  existing.pdf_path before: " << existing.pdf_path << std::endl;
-                                std::cerr << "  it.pdf_path: " << it.pdf_path << std::endl;
-                                
-                                auto mergeIfEmpty = [](std::string &dest, const std::string &src) { if (dest.empty() && !src.empty()) dest = src; };
-                                mergeIfEmpty(existing.title, it.title);
-                                mergeIfEmpty(existing.authors, it.authors);
-                                mergeIfEmpty(existing.year, it.year);
-                                mergeIfEmpty(existing.type, it.type);
-                                mergeIfEmpty(existing.doi, it.doi);
-                                mergeIfEmpty(existing.isbn, it.isbn);
-                                mergeIfEmpty(existing.publisher, it.publisher);
-                                mergeIfEmpty(existing.pages, it.pages);
-                                mergeIfEmpty(existing.volume, it.volume);
-                                mergeIfEmpty(existing.number, it.number);
-                                mergeIfEmpty(existing.journal, it.journal);
-                                mergeIfEmpty(existing.url, it.url);
-                                mergeIfEmpty(existing.abstract, it.abstract);
-                                // For pdf_path: append new attachments (they're already saved using existing.id)
-                                if (!it.pdf_path.empty()) {
-                                    if (existing.pdf_path.empty()) {
-                                        existing.pdf_path = it.pdf_path;
-                                    } else {
-                                        existing.pdf_path += ";" + it.pdf_path;
-                                    }
-                                }
-                                std::cerr << "  existing.pdf_path after: " << existing.pdf_path << std::endl;
-
-                                // merge extras
-                                QJsonParseError perr; QJsonObject exOld; if (!existing.extra.empty()) { QJsonDocument d = QJsonDocument::fromJson(QByteArray::fromStdString(existing.extra), &perr); if (!d.isNull() && d.isObject()) exOld = d.object(); }
-                                QJsonObject exNew; if (!it.extra.empty()) { QJsonDocument d2 = QJsonDocument::fromJson(QByteArray::fromStdString(it.extra), &perr); if (!d2.isNull() && d2.isObject()) exNew = d2.object(); }
-                                for (const QString &k : exNew.keys()) { if (!exOld.contains(k) || exOld.value(k).toString().trimmed().isEmpty()) exOld.insert(k, exNew.value(k)); }
-                                if (!exOld.isEmpty()) { QJsonDocument dd(exOld); existing.extra = dd.toJson(QJsonDocument::Compact).toStdString(); }
-
-                                if (!it.collection.empty()) this->db->addItemToCollection(existing.id, it.collection);
-                                this->db->updateItem(existing);
-                                std::cerr << "Updated existing item, setting ok=true, createdId=" << existing.id << std::endl;
-                                ok = true; createdId = existing.id;
-                                if (this->reloadCb) this->reloadCb();
-                                if (this->selectCb) this->selectCb(createdId);
-                            } else {
-                                this->db->addItem(it);
-                                ok = true; createdId = it.id;
-                                if (this->reloadCb) this->reloadCb();
-                                if (this->selectCb) this->selectCb(createdId);
-                            }
-                        }
-                        QJsonObject respObj; respObj["success"] = ok; respObj["id"] = QJsonValue(QString::fromStdString(createdId)); QJsonDocument respDoc(respObj);
-                        QByteArray out = respDoc.toJson(QJsonDocument::Compact);
-                        QByteArray resp = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(out.size()) + "\r\n\r\n" + out;
-                        socket->write(resp); socket->flush(); socket->disconnectFromHost(); return;
+                        handleSave(socket, body, responseEncoding);
+                        return;
                     }
 
+                    if (method == "POST" && path == "/connector/saveBatch") {
+                        handleSaveBatch(socket, body, responseEncoding);
+                        return;
+                    }
+
+                    metrics.notFound.fetch_add(1, std::memory_order_relaxed);
                     QByteArray out = "{\"error\":\"not found\"}";
-                    QByteArray resp = "HTTP/1.1 404 Not Found\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(out.size()) + "\r\n\r\n" + out;
-                    socket->write(resp); socket->flush(); socket->disconnectFromHost();
+                    sendJson(socket, "404 Not Found", out);
                 });
             }
         });
@@ -309,6 +171,483 @@ private:
     Database *db{nullptr};
     std::function<void()> reloadCb;
     std::function<void(const std::string&)> selectCb;
+    ConnectorMetrics metrics;
+    static constexpr qint64 kMaxInflatedBodyBytes = 512ll * 1024 * 1024; // guards against gzip bombs
+    static constexpr int kCompressMinBytes = 1024; // smaller responses are not worth compressing
+
+    struct PendingRequest {
+        QByteArray head;              // bytes received before the header terminator
+        QByteArray header;
+        QByteArray body;              // identity body, or the inflated one once complete
+        qint64 contentLength{-1};     // -1 until the headers have been parsed
+        qint64 received{0};           // body bytes read off the socket
+        qint64 wireBytes{0};
+        std::unique_ptr<Inflater> inflater;
+        bool processed{false};
+    };
+    // Distinguishes ETags across restarts (the DB revision counter starts at zero each run)
+    const QByteArray instanceTag = QByteArray::number(QDateTime::currentMSecsSinceEpoch(), 36);
+
+    // Server-sent events state
+    static constexpr int kEventMinIntervalMs = 250;   // at most four flushes per second
+    static constexpr int kEventMaxItemChanges = 500;  // beyond this, clients are told to refetch
+    QList<QPointer<QTcpSocket>> eventClients;
+    QTimer *eventFlushTimer{nullptr};
+    QTimer *eventKeepAliveTimer{nullptr};
+    QElapsedTimer sinceLastFlush;
+    QHash<QString, QString> pendingItemOps;       // item id -> insert/update/delete
+    QList<QString> pendingItemOrder;              // first-seen order of pendingItemOps keys
+    QJsonArray pendingCollectionOps;
+
+    // Verbose per-request logging, opt-in with BELLO_CONNECTOR_DEBUG=1
+    static bool debugLogging() {
+        static const bool enabled = [] { const char *v = std::getenv("BELLO_CONNECTOR_DEBUG"); return v && std::string(v) == "1"; }();
+        return enabled;
+    }
+
+    // Case-insensitive lookup of a request header value
+    static QByteArray headerValue(const QByteArray &header, const QByteArray &name) {
+        const QByteArray prefix = name.toLower() + ":";
+        for (const QByteArray &line : header.split('\n')) {
+            if (line.toLower().startsWith(prefix)) return line.mid(prefix.size()).trimmed();
+        }
+        return QByteArray();
+    }
+
+    // Write a complete response and close the connection. Bodies above
+    // kCompressMinBytes are compressed when the client negotiated an encoding.
+    void sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, QByteArray out, const QByteArray &encoding = QByteArray()) {
+        QByteArray extra;
+        if (!encoding.isEmpty() && out.size() >= kCompressMinBytes) {
+            Deflater deflater(encoding == "gzip" ? Deflater::Gzip : Deflater::Zlib);
+            if (deflater.isValid()) {
+                out = deflater.compress(out, Deflater::Finish);
+                extra = "Content-Encoding: " + encoding + "\r\nVary: Accept-Encoding\r\n";
+            }
+        }
+        QByteArray resp = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType + "\r\n" + extra
+            + "Content-Length: " + QByteArray::number(out.size()) + "\r\n\r\n" + out;
+        socket->write(resp); socket->flush(); socket->disconnectFromHost();
+    }
+
+    void sendJson(QTcpSocket *socket, const QByteArray &status, const QByteArray &out, const QByteArray &encoding = QByteArray()) {
+        sendResponse(socket, status, "application/json", out, encoding);
+    }
+
+    // Send one chunk of a `Transfer-Encoding: chunked` response
+    static void writeChunk(QTcpSocket *socket, const QByteArray &data) {
+        if (data.isEmpty()) return;
+        socket->write(QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n");
+    }
+
+    // GET /connector/items?limit=&offset=&cursor=&collection=&q=&since=
+    // Filters, ordering and paging run in SQL; the JSON array is streamed one DB chunk at a
+    // time. The ETag is derived from the DB revision, so unchanged polls get a 304.
+    void handleItems(QTcpSocket *socket, const QByteArray &header, const QByteArray &path, const QByteArray &encoding) {
+        ItemQuery q;
+        int qidx = path.indexOf('?');
+        if (qidx != -1) {
+            QByteArray qs = path.mid(qidx + 1);
+            qs.replace('+', "%20");
+            QUrlQuery query(QString::fromUtf8(qs));
+            bool ok = false;
+            int v = query.queryItemValue("limit").toInt(&ok);
+            if (ok && v > 0 && v <= 1000) q.limit = v;
+            v = query.queryItemValue("offset").toInt(&ok);
+            if (ok && v > 0) q.offset = v;
+            q.cursor = query.queryItemValue("cursor", QUrl::FullyDecoded).toStdString();
+            q.collection = query.queryItemValue("collection", QUrl::FullyDecoded).toStdString();
+            q.search = query.queryItemValue("q", QUrl::FullyDecoded).trimmed().toStdString();
+            q.since = query.queryItemValue("since", QUrl::FullyDecoded).toStdString();
+        }
+
+        const QByteArray etag = "\"" + instanceTag + "-" + QByteArray::number((qulonglong)db->revision()) + "-"
+            + QByteArray::number((qulonglong)qHash(path), 16) + (encoding.isEmpty() ? QByteArray() : "-" + encoding) + "\"";
+        if (headerValue(header, "If-None-Match") == etag) {
+            socket->write("HTTP/1.1 304 Not Modified\r\nETag: " + etag + "\r\nVary: Accept-Encoding\r\nContent-Length: 0\r\n\r\n");
+            socket->flush(); socket->disconnectFromHost();
+            return;
+        }
+
+        // Compressed listings are flushed once per DB chunk so the client can parse incrementally
+        std::unique_ptr<Deflater> deflater;
+        if (!encoding.isEmpty()) {
+            deflater = std::make_unique<Deflater>(encoding == "gzip" ? Deflater::Gzip : Deflater::Zlib);
+            if (!deflater->isValid()) deflater.reset();
+        }
+        socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n"
+                      + (deflater ? "Content-Encoding: " + encoding + "\r\n" : QByteArray())
+                      + "Vary: Accept-Encoding\r\nCache-Control: no-cache\r\nETag: " + etag + "\r\n\r\n");
+        bool first = true;
+        QByteArray piece = "[";
+        db->queryItems(q, [&](const std::vector<Item> &items) {
+            for (const auto &it : items) {
+                QJsonObject o;
+                o["id"] = QString::fromStdString(it.id);
+                o["title"] = QString::fromStdString(it.title);
+                o["authors"] = QString::fromStdString(it.authors);
+                o["year"] = QString::fromStdString(it.year);
+                o["doi"] = QString::fromStdString(it.doi);
+                o["url"] = QString::fromStdString(it.url);
+                o["collection"] = QString::fromStdString(it.collection);
+                o["modified"] = QString::fromStdString(it.modified);
+                if (!first) piece += ',';
+                piece += QJsonDocument(o).toJson(QJsonDocument::Compact);
+                first = false;
+            }
+            writeChunk(socket, deflater ? deflater->compress(piece, Deflater::SyncFlush) : piece);
+            piece.clear();
+        });
+        piece += ']';
+        writeChunk(socket, deflater ? deflater->compress(piece, Deflater::Finish) : piece);
+        socket->write("0\r\n\r\n");
+        socket->flush(); socket->disconnectFromHost();
+    }
+
+    // GET /connector/events: a long-lived text/event-stream. Each message is
+    //   event: changes / id: <revision> / data: {"revision":N,"items":[{"id","op"}],"collections":[...]}
+    // or {"revision":N,"reset":true} when too much changed and clients should refetch.
+    void handleEvents(QTcpSocket *socket) {
+        socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                      "Connection: keep-alive\r\n\r\n");
+        QJsonObject hello; hello["revision"] = QString::number((qulonglong)db->revision());
+        socket->write("retry: 3000\nevent: hello\ndata: " + QJsonDocument(hello).toJson(QJsonDocument::Compact) + "\n\n");
+        socket->flush();
+        eventClients.append(QPointer<QTcpSocket>(socket));
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            eventClients.removeAll(QPointer<QTcpSocket>(socket));
+            if (eventClients.isEmpty()) eventKeepAliveTimer->stop();
+            socket->deleteLater();
+        });
+        if (!eventKeepAliveTimer->isActive()) eventKeepAliveTimer->start();
+    }
+
+    void broadcastEvent(const QByteArray &message) {
+        for (int i = eventClients.size() - 1; i >= 0; --i) {
+            QTcpSocket *client = eventClients[i];
+            if (!client || client->state() != QAbstractSocket::ConnectedState) { eventClients.removeAt(i); continue; }
+            client->write(message);
+            client->flush();
+        }
+        if (eventClients.isEmpty()) eventKeepAliveTimer->stop();
+    }
+
+    // Coalesce a DB change into the pending batch and schedule a rate-limited flush.
+    // insert+update -> insert, insert+delete -> nothing, update+delete -> delete,
+    // delete+insert -> update.
+    void queueChange(const DbChange &c) {
+        if (eventClients.isEmpty()) return; // nobody listening: zero cost
+        if (c.kind == DbChange::ItemInserted || c.kind == DbChange::ItemUpdated || c.kind == DbChange::ItemDeleted) {
+            const QString id = QString::fromStdString(c.id);
+            const QString op = c.kind == DbChange::ItemInserted ? "insert" : c.kind == DbChange::ItemUpdated ? "update" : "delete";
+            auto prev = pendingItemOps.find(id);
+            if (prev == pendingItemOps.end()) {
+                pendingItemOps.insert(id, op);
+                pendingItemOrder.append(id);
+            } else if (prev.value() == "insert" && op == "delete") {
+                pendingItemOps.erase(prev);
+                pendingItemOrder.removeOne(id);
+            } else if (prev.value() == "delete" && op == "insert") {
+                prev.value() = "update";
+            } else if (prev.value() != "insert") {
+                prev.value() = op;
+            }
+        } else {
+            QJsonObject o;
+            o["op"] = c.kind == DbChange::CollectionAdded ? "add" : c.kind == DbChange::CollectionRenamed ? "rename" : "delete";
+            o["name"] = QString::fromStdString(c.id);
+            if (c.kind == DbChange::CollectionRenamed) o["newName"] = QString::fromStdString(c.detail);
+            if (!pendingCollectionOps.contains(o)) pendingCollectionOps.append(o);
+        }
+        if (eventFlushTimer->isActive()) return;
+        int wait = 0;
+        if (sinceLastFlush.isValid()) wait = qMax<qint64>(0, kEventMinIntervalMs - sinceLastFlush.elapsed());
+        eventFlushTimer->start(wait);
+    }
+
+    void flushEvents() {
+        if (pendingItemOrder.isEmpty() && pendingCollectionOps.isEmpty()) return;
+        sinceLastFlush.start();
+        QJsonObject payload;
+        payload["revision"] = QString::number((qulonglong)db->revision());
+        if (pendingItemOrder.size() > kEventMaxItemChanges) {
+            payload["reset"] = true;
+        } else {
+            QJsonArray items;
+            for (const QString &id : pendingItemOrder) {
+                QJsonObject o; o["id"] = id; o["op"] = pendingItemOps.value(id);
+                items.append(o);
+            }
+            payload["items"] = items;
+            payload["collections"] = pendingCollectionOps;
+        }
+        pendingItemOps.clear();
+        pendingItemOrder.clear();
+        pendingCollectionOps = QJsonArray();
+        broadcastEvent("event: changes\nid: " + QByteArray::number((qulonglong)db->revision()) + "\ndata: "
+                       + QJsonDocument(payload).toJson(QJsonDocument::Compact) + "\n\n");
+    }
+
+    // Build an Item from the extension's `data` object (id, attachments and collection are left to the caller)
+    static Item itemFromData(const QJsonObject &data) {
+        Item it;
+        it.title = data.value("title").toString().toStdString();
+        it.authors = data.value("authors").toString().toStdString();
+        it.year = data.value("year").toString().toStdString();
+        QString incomingType = data.value("type").toString();
+        QString incomingBibtex = data.value("bibtexType").toString();
+        it.type = incomingType.toStdString();
+        if ((it.type.empty() || incomingBibtex.size() > 0) && !incomingBibtex.isEmpty()) it.type = incomingBibtex.toStdString();
+        it.doi = data.value("doi").toString().toStdString();
+        it.isbn = data.value("isbn").toString().toStdString();
+        it.publisher = data.value("publisher").toString().toStdString();
+        it.pages = data.value("pages").toString().toStdString();
+        it.volume = data.value("volume").toString().toStdString();
+        it.number = data.value("number").toString().toStdString();
+        it.journal = data.value("journal").toString().toStdString();
+        it.url = data.value("url").toString().toStdString();
+        it.abstract = data.value("abstract").toString().toStdString();
+        it.pdf_path = data.value("pdf_path").toString().toStdString();
+        it.extra = data.value("extra").toString().toStdString();
+        return it;
+    }
+
+    // Decode base64 attachments into ~/.local/share/bello/storage/<item-id> and return the written paths
+    QStringList saveAttachments(const QJsonArray &a, const std::string &storageId) {
+        QStringList savedPaths;
+        if (a.isEmpty()) return savedPaths;
+        QString home = QString::fromLocal8Bit(std::getenv("HOME"));
+        QString storageRoot = QDir::cleanPath(home + "/.local/share/bello/storage");
+        QDir().mkpath(storageRoot);
+        QString itemDir = storageRoot + "/" + QString::fromStdString(storageId);
+        QDir().mkpath(itemDir);
+        for (int ai = 0; ai < a.size(); ++ai) {
+            QJsonValue v = a.at(ai);
+            if (!v.isObject()) continue;
+            QJsonObject o = v.toObject();
+            QString fname = o.value("filename").toString();
+            QString b64 = o.value("data").toString();
+            if (b64.isEmpty() || fname.isEmpty()) continue;
+            QByteArray bytes;
+            {
+                ScopedTimer t(metrics.base64Seconds);
+                bytes = QByteArray::fromBase64(b64.toUtf8());
+            }
+            ScopedTimer t(metrics.diskWriteSeconds);
+            // Ensure unique filename
+            QString outPath = itemDir + "/" + fname;
+            QFile f(outPath);
+            int idx = 1;
+            while (f.exists()) {
+                QString stem = QFileInfo(fname).completeBaseName();
+                QString ext = QFileInfo(fname).suffix();
+                QString candidate = QString("%1_%2%3").arg(stem).arg(idx).arg(ext.isEmpty()?QString():QString('.' + ext));
+                outPath = itemDir + "/" + candidate;
+                f.setFileName(outPath);
+                ++idx;
+            }
+            if (f.open(QIODevice::WriteOnly)) {
+                f.write(bytes);
+                f.close();
+                savedPaths << outPath;
+                if (debugLogging()) std::cerr << "BrowserConnector: wrote " << bytes.size() << " bytes to " << outPath.toStdString() << std::endl;
+            } else {
+                qWarning("Connector: failed to write attachment %s: %s", qPrintable(outPath), qPrintable(f.errorString()));
+            }
+        }
+        return savedPaths;
+    }
+
+    // (item id, path) pairs for addAttachments: the ';'-joined data.pdf_path, which is
+    // cleared, then the files saved from data.attachments
+    static void collectAttachments(Item &it, const std::string &itemId, const QStringList &saved,
+                                   std::vector<std::pair<std::string, std::string>> &out) {
+        for (auto &p : splitAttachmentPaths(it.pdf_path)) out.emplace_back(itemId, std::move(p));
+        it.pdf_path.clear();
+        for (const QString &p : saved) out.emplace_back(itemId, p.toStdString());
+    }
+
+    void handleSave(QTcpSocket *socket, const QByteArray &body, const QByteArray &encoding) {
+        QJsonParseError err; QJsonDocument reqDoc;
+        {
+            ScopedTimer t(metrics.parseSeconds);
+            reqDoc = QJsonDocument::fromJson(body, &err);
+        }
+        if (debugLogging()) std::cerr << "BrowserConnector: POST /connector/save, " << body.size() << " bytes, parse: " << err.errorString().toStdString() << std::endl;
+
+        bool ok = false; std::string createdId;
+        if (!reqDoc.isNull() && err.error == QJsonParseError::NoError && reqDoc.isObject()) {
+            QJsonObject root = reqDoc.object();
+            QJsonObject data = root.value("data").toObject();
+
+            Item it = itemFromData(data);
+
+            // First, check if this is an update to an existing item
+            Item existing; bool found = false;
+            {
+                ScopedTimer t(metrics.dedupeSeconds);
+                if (!it.doi.empty()) found = this->db->findItemByDOI(it.doi, existing);
+                if (!found && !it.isbn.empty()) found = this->db->findItemByISBN(it.isbn, existing);
+                if (!found && !it.title.empty() && !it.authors.empty()) found = this->db->findItemByTitleAndAuthor(it.title, it.authors, existing);
+            }
+
+            // Determine which ID to use for storage
+            std::string storageId = found ? existing.id : gen_uuid();
+            it.id = storageId;
 
-        
+            // Handle attachments embedded as base64 in `data.attachments` (optional)
+            QStringList savedPaths;
+            if (data.contains("attachments") && data.value("attachments").isArray()) {
+                savedPaths = saveAttachments(data.value("attachments").toArray(), storageId);
+            }
+            std::vector<std::pair<std::string, std::string>> attachments;
+            collectAttachments(it, storageId, savedPaths, attachments);
+
+            it.collection = data.value("collection").toString().toStdString();
+
+            // Use the 'found' and 'existing' from earlier lookup
+            {
+                ScopedTimer t(metrics.dbWriteSeconds);
+                if (found) {
+                    mergeItemFields(existing, it);
+                    if (!it.collection.empty()) this->db->addItemToCollection(existing.id, it.collection);
+                    this->db->updateItem(existing);
+                    ok = true; createdId = existing.id;
+                } else {
+                    this->db->addItem(it);
+                    ok = true; createdId = it.id;
+                }
+                this->db->addAttachments(attachments);
+            }
+            if (debugLogging()) std::cerr << "BrowserConnector: " << (found ? "merged into " : "created ") << createdId << std::endl;
+            ScopedTimer t(metrics.uiRefreshSeconds);
+            if (this->reloadCb) this->reloadCb();
+            if (this->selectCb) this->selectCb(createdId);
+        }
+        QJsonObject respObj; respObj["success"] = ok; respObj["id"] = QJsonValue(QString::fromStdString(createdId)); QJsonDocument respDoc(respObj);
+        sendJson(socket, "200 OK", respDoc.toJson(QJsonDocument::Compact), encoding);
+    }
+
+    // POST /connector/saveBatch: {"items": [<data>, ...]} (a bare array is accepted too).
+    // Entries are deduplicated against the library with one set-based query and against
+    // each other in memory; new entries go through the bulk insert path and the UI is
+    // refreshed once at the end.
+    void handleSaveBatch(QTcpSocket *socket, const QByteArray &body, const QByteArray &encoding) {
+        QJsonParseError err; QJsonDocument reqDoc;
+        {
+            ScopedTimer t(metrics.parseSeconds);
+            reqDoc = QJsonDocument::fromJson(body, &err);
+        }
+        QJsonArray entries;
+        if (err.error == QJsonParseError::NoError) {
+            if (reqDoc.isArray()) entries = reqDoc.array();
+            else if (reqDoc.isObject()) entries = reqDoc.object().value("items").toArray();
+        }
+        if (entries.isEmpty()) {
+            sendJson(socket, "400 Bad Request", "{\"success\":false,\"error\":\"expected a non-empty items array\"}");
+            return;
+        }
+
+        std::vector<Item> incoming;
+        std::vector<QJsonArray> attachments;
+        incoming.reserve(entries.size());
+        attachments.reserve(entries.size());
+        for (const QJsonValue &v : entries) {
+            QJsonObject data = v.toObject();
+            // accept both {"data": {...}} (the single-save shape) and bare data objects
+            if (data.contains("data") && data.value("data").isObject()) data = data.value("data").toObject();
+            Item it = itemFromData(data);
+            it.collection = data.value("collection").toString().toStdString();
+            incoming.push_back(std::move(it));
+            attachments.push_back(data.value("attachments").toArray());
+        }
+
+        std::vector<std::string> existingIds;
+        QHash<QString, Item> merged;
+        QSet<QString> changed;
+        {
+            ScopedTimer t(metrics.dedupeSeconds);
+            existingIds = db->findExistingItems(incoming);
+            std::vector<std::string> matchedIds;
+            for (const auto &id : existingIds) if (!id.empty()) matchedIds.push_back(id);
+            for (auto &e : db->getItems(matchedIds)) merged.insert(QString::fromStdString(e.id), std::move(e));
+        }
+
+        // Entries repeated inside the batch merge into the first occurrence
+        QHash<QString, size_t> seenKeys;
+        auto batchKeys = [](const Item &it) {
+            QStringList keys;
+            for (const auto &k : identityKeys(it)) keys << QString::fromStdString(k);
+            return keys;
+        };
+
+        std::vector<Item> toInsert;
+        std::vector<std::pair<std::string, std::string>> memberships, attachmentPairs;
+        QJsonArray ids;
+        for (size_t i = 0; i < incoming.size(); ++i) {
+            Item &it = incoming[i];
+            const QString existingId = QString::fromStdString(existingIds[i]);
+            if (!existingId.isEmpty() && merged.contains(existingId)) {
+                it.id = existingIds[i];
+                collectAttachments(it, it.id, saveAttachments(attachments[i], it.id), attachmentPairs);
+                if (mergeItemFields(merged[existingId], it)) changed.insert(existingId);
+                if (!it.collection.empty()) memberships.emplace_back(it.id, it.collection);
+                ids.append(existingId);
+                continue;
+            }
+
+            const QStringList keys = batchKeys(it);
+            bool dup = false;
+            for (const QString &k : keys) {
+                auto found = seenKeys.constFind(k);
+                if (found == seenKeys.constEnd()) continue;
+                Item &first = toInsert[found.value()];
+                collectAttachments(it, first.id, saveAttachments(attachments[i], first.id), attachmentPairs);
+                mergeItemFields(first, it);
+                if (!it.collection.empty() && it.collection != first.collection) memberships.emplace_back(first.id, it.collection);
+                ids.append(QString::fromStdString(first.id));
+                dup = true;
+                break;
+            }
+            if (dup) continue;
+
+            it.id = gen_uuid();
+            collectAttachments(it, it.id, saveAttachments(attachments[i], it.id), attachmentPairs);
+            for (const QString &k : keys) seenKeys.insert(k, toInsert.size());
+            ids.append(QString::fromStdString(it.id));
+            toInsert.push_back(std::move(it));
+        }
+
+        // Only items that actually changed are rewritten
+        std::vector<Item> toUpdate;
+        toUpdate.reserve(changed.size());
+        for (const QString &id : changed) toUpdate.push_back(merged.value(id));
+
+        // The whole batch is one transaction: all of it is saved, or none
+        bool saved;
+        {
+            ScopedTimer t(metrics.dbWriteSeconds);
+            db->beginTransaction();
+            db->addItems(toInsert);
+            if (!toUpdate.empty()) db->updateItems(toUpdate);
+            if (!memberships.empty()) db->addItemsToCollections(memberships);
+            if (!attachmentPairs.empty()) db->addAttachments(attachmentPairs);
+            saved = db->commitTransaction();
+        }
+        if (!saved) {
+            sendJson(socket, "500 Internal Server Error", "{\"success\":false,\"error\":\"database write failed\"}", encoding);
+            return;
+        }
+        {
+            ScopedTimer t(metrics.uiRefreshSeconds);
+            if (this->reloadCb) this->reloadCb();
+        }
+
+        QJsonObject respObj;
+        respObj["success"] = true;
+        respObj["ids"] = ids;
+        respObj["created"] = (int)toInsert.size();
+        respObj["merged"] = (int)(incoming.size() - toInsert.size());
+        sendJson(socket, "200 OK", QJsonDocument(respObj).toJson(QJsonDocument::Compact), encoding);
+    }
 };
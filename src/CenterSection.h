@@ -13,6 +13,8 @@
 #include <QIcon>
 #include <QStyle>
 #include <QShortcut>
+#include <unordered_map>
+#include "BibTeX.h"
 
 // Forward declaration to avoid circular dependency
 class MainWindow;
@@ -63,18 +65,7 @@ inline void MainWindow::onItemContextMenuRequested(const QPoint &pos) {
     
         if (multipleSelected) {
         menu.addAction(QString("Open %1 PDFs").arg(selectedItems.size()), [this](){
-            auto selectedItems = ui->itemsList->selectedItems();
-            for (auto *item : selectedItems) {
-                QString pdfPath = item->data(Qt::UserRole + 1).toString();
-                if (pdfPath.isEmpty()) continue;
-                // Support multiple attached files separated by ';'
-                for (const QString &p : pdfPath.split(';', Qt::SkipEmptyParts)) {
-                    QString trimmed = p.trimmed();
-                    if (!trimmed.isEmpty() && QFile::exists(trimmed)) {
-                        QDesktopServices::openUrl(QUrl::fromLocalFile(trimmed));
-                    }
-                }
-            }
+            openAttachments(ui->itemsList->selectedItems());
         });
         
         menu.addAction(QString("Copy %1 Citations").arg(selectedItems.size()), [this](){
@@ -236,16 +227,7 @@ inline void MainWindow::onOpenItem() {
     auto selectedItems = ui->itemsList->selectedItems();
     if (selectedItems.isEmpty()) return;
     
-    for (auto *item : selectedItems) {
-        QString pdf = item->data(Qt::UserRole + 1).toString();
-        if (pdf.isEmpty()) continue;
-        for (const QString &p : pdf.split(';', Qt::SkipEmptyParts)) {
-            QString trimmed = p.trimmed();
-            if (!trimmed.isEmpty() && QFile::exists(trimmed)) {
-                QDesktopServices::openUrl(QUrl::fromLocalFile(trimmed));
-            }
-        }
-    }
+    const int missing = openAttachments(selectedItems);
     
     // Show message if some items don't have PDFs
     int itemsWithoutPdf = 0;
@@ -260,22 +242,40 @@ inline void MainWindow::onOpenItem() {
             ? "No PDFs attached to selected items." 
             : QString("%1 of %2 selected items have no PDF attached.").arg(itemsWithoutPdf).arg(selectedItems.size());
         QMessageBox::information(this, "PDF Status", message);
+    } else if (missing > 0) {
+        QMessageBox::information(this, "PDF Status", QString("%1 attached files were not found.").arg(missing));
+    }
+}
+
+inline int MainWindow::openAttachments(const QList<QListWidgetItem*> &items) {
+    std::vector<std::string> ids;
+    ids.reserve(items.size());
+    for (auto *item : items) ids.push_back(item->data(Qt::UserRole).toString().toStdString());
+    int missing = 0;
+    for (const auto &a : db->getAttachments(ids)) {
+        // Files not scanned yet are handed to the desktop as they are
+        if (a.scanned && !a.present) {
+            ++missing;
+            continue;
+        }
+        QDesktopServices::openUrl(QUrl::fromLocalFile(QString::fromStdString(a.path)));
     }
+    return missing;
 }
 
 inline void MainWindow::onRenameItem() {
     auto *item = ui->itemsList->currentItem();
     if (!item) return;
     
-    Item it;
-    if (!db->getItem(item->data(Qt::UserRole).toString().toStdString(), it)) return;
+    std::string id = item->data(Qt::UserRole).toString().toStdString();
+    std::string title;
+    if (!db->getItemField(id, "title", title)) return;
     
     bool ok;
     QString newTitle = QInputDialog::getText(this, "Rename Item", "New title:", 
-                                              QLineEdit::Normal, QString::fromStdString(it.title), &ok);
+                                              QLineEdit::Normal, QString::fromStdString(title), &ok);
     if (ok && !newTitle.trimmed().isEmpty()) {
-        it.title = newTitle.trimmed().toStdString();
-        db->updateItem(it);
+        db->patchItem(id, {{"title", newTitle.trimmed().toStdString()}});
         reload();
     }
 }
@@ -299,14 +299,22 @@ inline void MainWindow::onDeleteItem() {
 inline void MainWindow::copySelectedAsBibTeX() {
     auto selectedItems = ui->itemsList->selectedItems();
     if (selectedItems.isEmpty()) return;
-    QStringList bibTexEntries;
-    for (auto *item : selectedItems) {
-        Item it;
-        if (db->getItem(item->data(Qt::UserRole).toString().toStdString(), it)) {
-            bibTexEntries << itemToBibTeX(it);
+    // Fetch the whole selection in one query, then emit it in selection order
+    std::vector<std::string> ids;
+    ids.reserve(selectedItems.size());
+    for (auto *item : selectedItems) ids.push_back(item->data(Qt::UserRole).toString().toStdString());
+    std::unordered_map<std::string, Item> byId;
+    for (auto &it : db->getItems(ids)) byId.emplace(it.id, std::move(it));
+
+    QByteArray text;
+    {
+        BibTeXWriter writer(bibtex, [&text](const QByteArray &block) { text += block; });
+        for (const auto &id : ids) {
+            auto found = byId.find(id);
+            if (found != byId.end()) writer.write(found->second);
         }
     }
-    QApplication::clipboard()->setText(bibTexEntries.join("\n\n"));
+    QApplication::clipboard()->setText(QString::fromUtf8(text));
 }
 
 inline void MainWindow::ensureShortcuts() {
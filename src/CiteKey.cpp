@@ -0,0 +1,87 @@
+#include "CiteKey.h"
+#include <algorithm>
+
+namespace {
+
+bool isAsciiAlnum(char c) { return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'); }
+char asciiLower(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+bool isAsciiSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+std::string trimmed(const std::string &s) {
+    size_t b = 0, e = s.size();
+    while (b < e && isAsciiSpace(s[b])) ++b;
+    while (e > b && isAsciiSpace(s[e - 1])) --e;
+    return s.substr(b, e - b);
+}
+
+// Lowercase, every run of characters outside [a-z0-9] becomes one '_', no
+// leading or trailing '_'; "key" if nothing is left. Bytes of multi-byte UTF-8
+// characters are outside the range, as the characters were in the regex version.
+void appendSanitizedKey(const std::string &s, std::string &out) {
+    const size_t start = out.size();
+    for (char c : s) {
+        c = asciiLower(c);
+        if (isAsciiAlnum(c)) out += c;
+        else if (out.size() > start && out.back() != '_') out += '_';
+    }
+    if (out.size() > start && out.back() == '_') out.pop_back();
+    if (out.size() == start) out += "key";
+}
+
+// Last name from "Last, First" or the final word of "First Last"
+std::string authorLastName(const std::string &authors) {
+    std::string a = trimmed(authors);
+    size_t comma = a.find(',');
+    if (comma != std::string::npos) return trimmed(a.substr(0, comma));
+    size_t e = a.find_last_not_of(' ');
+    if (e == std::string::npos) return std::string();
+    size_t b = a.rfind(' ', e);
+    size_t start = b == std::string::npos ? 0 : b + 1;
+    return a.substr(start, e - start + 1);
+}
+
+// First run of ASCII letters and digits in the lowercased title
+std::string firstTitleToken(const std::string &title) {
+    size_t i = 0;
+    while (i < title.size() && !isAsciiAlnum(asciiLower(title[i]))) ++i;
+    size_t j = i;
+    while (j < title.size() && isAsciiAlnum(asciiLower(title[j]))) ++j;
+    return title.substr(i, j - i);
+}
+
+} // namespace
+
+std::string citeKeyBase(const Item &it) {
+    std::string key;
+    appendSanitizedKey(authorLastName(it.authors), key);
+    std::string token = firstTitleToken(trimmed(it.title));
+    if (!token.empty()) {
+        key += '_';
+        appendSanitizedKey(token, key);
+    }
+    std::string year = trimmed(it.year);
+    if (!year.empty()) {
+        key += '_';
+        appendSanitizedKey(year, key);
+    }
+    return key;
+}
+
+std::string citeKeyFromIdentifier(const Item &it) {
+    std::string key;
+    if (!trimmed(it.doi).empty()) appendSanitizedKey(it.doi, key);
+    else if (!trimmed(it.isbn).empty()) appendSanitizedKey(it.isbn, key);
+    return key;
+}
+
+std::string citeKeySuffix(size_t n) {
+    // Bijective base 26, so every suffix is reachable and none is skipped
+    std::string out;
+    while (n > 0) {
+        --n;
+        out += char('a' + n % 26);
+        n /= 26;
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Database.h"
+#include <string>
+
+// Citation key derivation, shared by the database (which stores one unique key
+// per item) and the BibTeX exporter. No Qt dependency.
+
+// author_title_year: sanitized last name of the first author ("key" when there
+// is none), then the first title word and the year when present.
+std::string citeKeyBase(const Item &it);
+
+// Sanitized DOI, else sanitized ISBN, else "" (the "DOI or ISBN" key preference)
+std::string citeKeyFromIdentifier(const Item &it);
+
+// Disambiguation suffix for the n-th item sharing a base: "", "a" ... "z", "aa", "ab" ...
+std::string citeKeySuffix(size_t n);
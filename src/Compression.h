@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#ifdef BELLO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Incremental zlib wrappers used by the browser connector for
+// `Content-Encoding` request bodies and `Accept-Encoding` responses. Without
+// zlib (BELLO_HAVE_ZLIB undefined) compressed requests are refused and
+// responses are sent as they are.
+
+#ifdef BELLO_HAVE_ZLIB
+constexpr bool kHaveCompression = true;
+
+// Decompresses a gzip or zlib ("deflate") stream fed in arbitrary pieces, so a
+// compressed request body can be expanded as it arrives off the socket.
+class Inflater {
+public:
+    enum Status { Ok, Done, Error, TooLarge };
+
+    explicit Inflater(qsizetype maxOutput) : maxOutput(maxOutput) {
+        zs.zalloc = Z_NULL; zs.zfree = Z_NULL; zs.opaque = Z_NULL;
+        zs.next_in = Z_NULL; zs.avail_in = 0;
+        // 15 + 32: accept both gzip and zlib headers
+        ok = inflateInit2(&zs, 15 + 32) == Z_OK;
+    }
+    ~Inflater() { if (ok) inflateEnd(&zs); }
+    Inflater(const Inflater&) = delete;
+    Inflater &operator=(const Inflater&) = delete;
+
+    // Append the decompressed form of `data` to output()
+    Status feed(const char *data, qsizetype size) {
+        if (!ok) return Error;
+        if (finished) return size ? Error : Done; // trailing garbage after the stream
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = static_cast<uInt>(size);
+        char buf[16384];
+        do {
+            zs.next_out = reinterpret_cast<Bytef*>(buf);
+            zs.avail_out = sizeof(buf);
+            int rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) return Error;
+            out.append(buf, sizeof(buf) - zs.avail_out);
+            if (out.size() > maxOutput) return TooLarge;
+            if (rc == Z_STREAM_END) { finished = true; return zs.avail_in ? Error : Done; }
+            if (rc == Z_BUF_ERROR) break; // needs more input
+        } while (zs.avail_out == 0 || zs.avail_in > 0);
+        return Ok;
+    }
+
+    bool isFinished() const { return finished; }
+    QByteArray &output() { return out; }
+
+private:
+    z_stream zs{};
+    bool ok{false};
+    bool finished{false};
+    qsizetype maxOutput;
+    QByteArray out;
+};
+
+// Compresses a response body piece by piece; each call returns the bytes that
+// are ready to go on the wire.
+class Deflater {
+public:
+    enum Format { Gzip, Zlib };
+
+    explicit Deflater(Format format, int level = 6) {
+        zs.zalloc = Z_NULL; zs.zfree = Z_NULL; zs.opaque = Z_NULL;
+        // 15 + 16 writes a gzip wrapper; plain 15 is the zlib format HTTP calls "deflate"
+        ok = deflateInit2(&zs, level, Z_DEFLATED, format == Gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~Deflater() { if (ok) deflateEnd(&zs); }
+    Deflater(const Deflater&) = delete;
+    Deflater &operator=(const Deflater&) = delete;
+
+    // SyncFlush pushes everything buffered so far, at a few bytes of overhead,
+    // so streamed responses reach the client without waiting for the end.
+    enum Flush { NoFlush = Z_NO_FLUSH, SyncFlush = Z_SYNC_FLUSH, Finish = Z_FINISH };
+    QByteArray compress(const QByteArray &data, Flush flush = NoFlush) {
+        QByteArray result;
+        if (!ok) return result;
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        char buf[16384];
+        do {
+            zs.next_out = reinterpret_cast<Bytef*>(buf);
+            zs.avail_out = sizeof(buf);
+            deflate(&zs, flush);
+            result.append(buf, sizeof(buf) - zs.avail_out);
+        } while (zs.avail_out == 0);
+        return result;
+    }
+
+    bool isValid() const { return ok; }
+
+private:
+    z_stream zs{};
+    bool ok{false};
+};
+
+#else
+constexpr bool kHaveCompression = false;
+
+// Stand-ins so callers compile; never valid
+class Inflater {
+public:
+    enum Status { Ok, Done, Error, TooLarge };
+    explicit Inflater(qsizetype) {}
+    Status feed(const char *, qsizetype) { return Error; }
+    bool isFinished() const { return false; }
+    QByteArray &output() { return out; }
+private:
+    QByteArray out;
+};
+
+class Deflater {
+public:
+    enum Format { Gzip, Zlib };
+    enum Flush { NoFlush, SyncFlush, Finish };
+    explicit Deflater(Format, int = 6) {}
+    QByteArray compress(const QByteArray &data, Flush = NoFlush) { return data; }
+    bool isValid() const { return false; }
+};
+#endif
+
+// Pick a response encoding from an Accept-Encoding header: "gzip", "deflate" or
+// empty for identity. Entries with q=0 are refused; otherwise gzip wins ties.
+inline QByteArray negotiateEncoding(const QByteArray &acceptEncoding) {
+    if (!kHaveCompression) return QByteArray();
+    double gzipQ = -1, deflateQ = -1, anyQ = -1;
+    for (const QByteArray &entry : acceptEncoding.split(',')) {
+        QList<QByteArray> parts = entry.split(';');
+        QByteArray coding = parts[0].trimmed().toLower();
+        double q = 1.0;
+        for (int i = 1; i < parts.size(); ++i) {
+            QByteArray p = parts[i].trimmed();
+            if (p.startsWith("q=")) q = p.mid(2).toDouble();
+        }
+        if (coding == "gzip" || coding == "x-gzip") gzipQ = q;
+        else if (coding == "deflate") deflateQ = q;
+        else if (coding == "*") anyQ = q;
+    }
+    if (gzipQ < 0) gzipQ = anyQ;
+    if (deflateQ < 0) deflateQ = anyQ;
+    if (gzipQ > 0 && gzipQ >= deflateQ) return "gzip";
+    if (deflateQ > 0) return "deflate";
+    return QByteArray();
+}
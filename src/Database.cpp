@@ -0,0 +1,1891 @@
+#include "Database.h"
+#include "CiteKey.h"
+#include "Dedupe.h"
+#include "Identifiers.h"
+#include "StorageGC.h"
+
+#include <duckdb.hpp>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+struct Database::Impl {
+    duckdb::DuckDB db;
+    std::unique_ptr<duckdb::Connection> conn;
+    uint64_t revision = 0;
+    uint64_t collectionsRevision = 0;
+    std::vector<std::function<void(const DbChange&)>> listeners;
+    // Open transaction scopes (see beginTransaction) and the changes held until the outermost commits
+    int txDepth = 0;
+    bool txFailed = false;
+    std::vector<DbChange> pendingChanges;
+    // Prepared statements for patchItem/getItemField, keyed by column list
+    std::map<std::string, duckdb::unique_ptr<duckdb::PreparedStatement>> patchStatements;
+    std::map<std::string, duckdb::unique_ptr<duckdb::PreparedStatement>> fieldStatements;
+    duckdb::unique_ptr<duckdb::PreparedStatement> ensureCollectionStmt;
+    duckdb::unique_ptr<duckdb::PreparedStatement> childCollectionsStmt;
+    Impl(const std::string &path) : db(path), conn(std::make_unique<duckdb::Connection>(db)) {}
+};
+
+Database::Database(const std::string &path) : pimpl(new Impl(path)) {}
+
+Database::~Database() { delete pimpl; }
+
+void Database::init() {
+    try {
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS items (id TEXT PRIMARY KEY, title TEXT, authors TEXT, year TEXT, doi TEXT, isbn TEXT, type TEXT, abstract TEXT, address TEXT, publisher TEXT, journal TEXT, pages TEXT, volume TEXT, number TEXT, keywords TEXT, month TEXT, url TEXT, note TEXT, extra TEXT, pdf_path TEXT, collection TEXT);");
+        // Ensure older DBs get new columns (ignore errors if they already exist)
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN isbn TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN type TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN abstract TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN address TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN publisher TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN editor TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN booktitle TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN series TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN edition TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN chapter TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN school TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN institution TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN organization TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN howpublished TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN language TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN journal TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN pages TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN volume TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN number TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN keywords TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN month TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN url TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN note TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN extra TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN modified TIMESTAMP;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN citekey TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN citekey_base TEXT;"); } catch(...) {}
+        // Canonical DOI / ISBN-13 (see Identifiers.h), written alongside doi and isbn
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN doi_norm TEXT;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE items ADD COLUMN isbn13 TEXT;"); } catch(...) {}
+        pimpl->conn->Query("CREATE INDEX IF NOT EXISTS items_doi_norm ON items(doi_norm);");
+        pimpl->conn->Query("CREATE INDEX IF NOT EXISTS items_isbn13 ON items(isbn13);");
+        // NULL until assigned; DuckDB allows any number of NULLs under a unique index
+        pimpl->conn->Query("CREATE UNIQUE INDEX IF NOT EXISTS items_citekey ON items(citekey);");
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS collections (name TEXT PRIMARY KEY);");
+        // Create item_collections join table for many-to-many relationship
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS item_collections (item_id TEXT, collection TEXT, PRIMARY KEY (item_id, collection));");
+        // MinHash/LSH buckets for findDuplicateClusters, and the item version each item was indexed at
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS item_lsh (item_id TEXT, band INTEGER, bucket BIGINT);");
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS item_lsh_state (item_id TEXT, modified TIMESTAMP);");
+        // Linked .bib files and a content hash per entry, so a sync re-parses only changed entries
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS linked_bibs (path TEXT PRIMARY KEY, collection TEXT);");
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS linked_bib_entries (path TEXT, entry_key TEXT, hash UBIGINT, item_id TEXT, PRIMARY KEY (path, entry_key));");
+        // Collections kept exported to .bib files, with the byte range of each entry
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS live_exports (path TEXT PRIMARY KEY, collection TEXT, key_pref INTEGER, size BIGINT, hash UBIGINT);");
+        try { pimpl->conn->Query("ALTER TABLE live_exports ADD COLUMN hash UBIGINT;"); } catch(...) {}
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS live_export_entries (path TEXT, item_id TEXT, version TEXT, entry_offset BIGINT, entry_length BIGINT);");
+        // Attachments and the last known state of each file; checked is NULL until scanned
+        pimpl->conn->Query("CREATE TABLE IF NOT EXISTS attachments (item_id TEXT, ordinal INTEGER, path TEXT, size BIGINT, hash UBIGINT, mime TEXT, mtime BIGINT, present BOOLEAN, checked TIMESTAMP, PRIMARY KEY (item_id, path));");
+        try { pimpl->conn->Query("ALTER TABLE attachments ADD COLUMN ordinal INTEGER;"); } catch(...) {}
+        try { pimpl->conn->Query("ALTER TABLE attachments ADD COLUMN mime TEXT;"); } catch(...) {}
+        pimpl->conn->Query("CREATE INDEX IF NOT EXISTS attachments_item_id ON attachments(item_id);");
+        auto res = pimpl->conn->Query("SELECT COUNT(*) FROM collections");
+        if (res && !res->HasError() && res->RowCount() > 0) {
+            auto cnt = res->GetValue(0,0).ToString();
+            if (cnt == "0") {
+                pimpl->conn->Query("INSERT INTO collections (name) VALUES ('Rename or delete this collection');");
+                pimpl->conn->Query("INSERT INTO items (id,title,authors,year,doi,pdf_path,collection) VALUES ('seed-1','Add references here','','2025','','','Rename or delete this collection');");
+                pimpl->conn->Query("INSERT INTO item_collections (item_id, collection) VALUES ('seed-1', 'Rename or delete this collection');");
+            }
+        }
+        // Migrate existing items to item_collections table if needed
+        pimpl->conn->Query("INSERT OR IGNORE INTO item_collections (item_id, collection) SELECT id, collection FROM items WHERE collection != '';");
+        // Key items from databases that predate citekey (and the seed item)
+        assignCiteKeys({});
+        normalizeIdentifiers();
+        migrateAttachments();
+    } catch (std::exception &e) {
+        std::cerr << "DB init error: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+// Simple SQL escaper for single-quoted string literals
+static std::string escapeSQL(const std::string &s) {
+    std::string out;
+    out.reserve(s.size()*2);
+    for (char c : s) {
+        if (c == '\'') out += "''";
+        else out.push_back(c);
+    }
+    return out;
+}
+
+// Every persisted Item column, in the canonical SELECT order used throughout this file
+static const std::array<std::pair<const char*, std::string Item::*>, 31> kItemFields = {{
+    {"id", &Item::id}, {"title", &Item::title}, {"authors", &Item::authors}, {"year", &Item::year},
+    {"doi", &Item::doi}, {"isbn", &Item::isbn}, {"type", &Item::type}, {"abstract", &Item::abstract},
+    {"address", &Item::address}, {"publisher", &Item::publisher}, {"editor", &Item::editor},
+    {"booktitle", &Item::booktitle}, {"series", &Item::series}, {"edition", &Item::edition},
+    {"chapter", &Item::chapter}, {"school", &Item::school}, {"institution", &Item::institution},
+    {"organization", &Item::organization}, {"howpublished", &Item::howpublished}, {"language", &Item::language},
+    {"journal", &Item::journal}, {"pages", &Item::pages}, {"volume", &Item::volume}, {"number", &Item::number},
+    {"keywords", &Item::keywords}, {"month", &Item::month}, {"url", &Item::url}, {"note", &Item::note},
+    {"extra", &Item::extra}, {"pdf_path", &Item::pdf_path}, {"collection", &Item::collection}
+}};
+
+// Comma-separated column list matching kItemFields, optionally qualified ("i." -> "i.id,i.title,...")
+static std::string itemColumnList(const std::string &qualifier = std::string()) {
+    std::string out;
+    for (const auto &f : kItemFields) {
+        if (!out.empty()) out += ",";
+        out += qualifier + f.first;
+    }
+    return out;
+}
+
+// NULLs (e.g. columns added by ALTER TABLE on old databases) read back as empty strings
+static std::string valueToString(const duckdb::Value &v) {
+    return v.IsNull() ? std::string() : v.ToString();
+}
+
+// Row count reported by an INSERT/UPDATE/DELETE result
+static int64_t affectedRows(duckdb::QueryResult &res) {
+    if (res.HasError()) return 0;
+    auto chunk = res.Fetch();
+    if (!chunk || chunk->size() == 0) return 0;
+    return chunk->GetValue(0, 0).GetValue<int64_t>();
+}
+
+// Run "INSERT INTO collections (name) <select>" and return the names it inserted
+static std::vector<std::string> insertCollections(duckdb::Connection &conn, const std::string &select) {
+    std::vector<std::string> names;
+    auto res = conn.Query("INSERT INTO collections (name) " + select + " RETURNING name;");
+    if (!res || res->HasError()) return names;
+    for (size_t i = 0; i < res->RowCount(); ++i) names.push_back(valueToString(res->GetValue(0, i)));
+    return names;
+}
+
+// Fill an Item from a chunk row whose first 31 columns follow kItemFields
+static void itemFromChunk(duckdb::DataChunk &chunk, duckdb::idx_t row, Item &out) {
+    for (size_t c = 0; c < kItemFields.size(); ++c) {
+        out.*(kItemFields[c].second) = valueToString(chunk.GetValue(c, row));
+    }
+}
+
+// Create (or replace) a temporary staging table with one TEXT column per Item field,
+// plus doi_norm and isbn13, and bulk-load `items` into it through an Appender.
+static bool stageItems(duckdb::Connection &conn, const std::string &table, const std::vector<Item> &items) {
+    std::string ddl = "CREATE OR REPLACE TEMP TABLE " + table + " (";
+    for (size_t c = 0; c < kItemFields.size(); ++c) {
+        ddl += std::string(kItemFields[c].first) + " TEXT, ";
+    }
+    ddl += "doi_norm TEXT, isbn13 TEXT);";
+    auto res = conn.Query(ddl);
+    if (!res || res->HasError()) {
+        std::cerr << "DB staging error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return false;
+    }
+    try {
+        duckdb::Appender appender(conn, table);
+        for (const auto &it : items) {
+            appender.BeginRow();
+            for (const auto &f : kItemFields) appender.Append<duckdb::Value>(duckdb::Value(it.*(f.second)));
+            appender.Append<duckdb::Value>(duckdb::Value(normalizeDOI(it.doi)));
+            appender.Append<duckdb::Value>(duckdb::Value(normalizeISBN(it.isbn)));
+            appender.EndRow();
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB staging append error: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Create (or replace) a temporary table of TEXT `columns` and bulk-load `rows` into it
+static bool stageText(duckdb::Connection &conn, const std::string &table, const std::vector<std::string> &columns,
+                      const std::vector<std::vector<std::string>> &rows) {
+    std::string ddl = "CREATE OR REPLACE TEMP TABLE " + table + " (";
+    for (size_t c = 0; c < columns.size(); ++c) ddl += (c ? ", " : "") + columns[c] + " TEXT";
+    auto res = conn.Query(ddl + ");");
+    if (!res || res->HasError()) {
+        std::cerr << "DB staging error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return false;
+    }
+    try {
+        duckdb::Appender appender(conn, table);
+        for (const auto &row : rows) {
+            appender.BeginRow();
+            for (const auto &v : row) appender.Append<duckdb::Value>(duckdb::Value(v));
+            appender.EndRow();
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB staging append error: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+static std::vector<std::string> itemIds(const std::vector<Item> &items) {
+    std::vector<std::string> ids;
+    ids.reserve(items.size());
+    for (const auto &it : items) ids.push_back(it.id);
+    return ids;
+}
+
+// Attachment rows (item_id, ordinal, path) split out of the ';'-joined pdf_path of the
+// (id, pdf_path) rows of `source`: trimmed, blanks and repeated paths dropped
+static std::string splitPdfPaths(const std::string &source) {
+    return "SELECT item_id, CAST(row_number() OVER (PARTITION BY item_id ORDER BY n) AS INTEGER) AS ordinal, path FROM "
+           "(SELECT item_id, path, min(n) AS n FROM (SELECT id AS item_id, trim(unnest(string_split(pdf_path, ';'))) AS path, "
+           "generate_subscripts(string_split(pdf_path, ';'), 1) AS n FROM " + source + " WHERE COALESCE(pdf_path, '') <> '') "
+           "WHERE path <> '' GROUP BY item_id, path)";
+}
+
+void Database::addItem(const Item &it) {
+    // Escape fields to avoid SQL errors from quotes/newlines
+    std::string id = escapeSQL(it.id);
+    std::string title = escapeSQL(it.title);
+    std::string authors = escapeSQL(it.authors);
+    std::string year = escapeSQL(it.year);
+    std::string doi = escapeSQL(it.doi);
+    std::string isbn = escapeSQL(it.isbn);
+    std::string type = escapeSQL(it.type);
+    std::string abstract = escapeSQL(it.abstract);
+    std::string address = escapeSQL(it.address);
+    std::string publisher = escapeSQL(it.publisher);
+    std::string journal = escapeSQL(it.journal);
+    std::string pages = escapeSQL(it.pages);
+    std::string volume = escapeSQL(it.volume);
+    std::string number = escapeSQL(it.number);
+    std::string editor = escapeSQL(it.editor);
+    std::string booktitle = escapeSQL(it.booktitle);
+    std::string series = escapeSQL(it.series);
+    std::string edition = escapeSQL(it.edition);
+    std::string chapter = escapeSQL(it.chapter);
+    std::string school = escapeSQL(it.school);
+    std::string institution = escapeSQL(it.institution);
+    std::string organization = escapeSQL(it.organization);
+    std::string howpublished = escapeSQL(it.howpublished);
+    std::string language = escapeSQL(it.language);
+    std::string keywords = escapeSQL(it.keywords);
+    std::string month = escapeSQL(it.month);
+    std::string url = escapeSQL(it.url);
+    std::string note = escapeSQL(it.note);
+    std::string extra = escapeSQL(it.extra);
+    std::string pdf_path = escapeSQL(it.pdf_path);
+    std::string collection = escapeSQL(it.collection);
+    std::string doiNorm = escapeSQL(normalizeDOI(it.doi));
+    std::string isbn13 = escapeSQL(normalizeISBN(it.isbn));
+
+    std::string sql = "INSERT INTO items (id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection,doi_norm,isbn13,modified) VALUES ('" +
+        id + "','" + title + "','" + authors + "','" + year + "','" + doi + "','" + isbn + "','" + type + "','" + abstract + "','" + address + "','" + publisher + "','" + editor + "','" + booktitle + "','" + series + "','" + edition + "','" + chapter + "','" + school + "','" + institution + "','" + organization + "','" + howpublished + "','" + language + "','" + journal + "','" + pages + "','" + volume + "','" + number + "','" + keywords + "','" + month + "','" + url + "','" + note + "','" + extra + "','" + pdf_path + "','" + collection + "','" + doiNorm + "','" + isbn13 + "',current_timestamp);";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError()) {
+        std::cerr << "DB insert error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return;
+    }
+    if (!it.pdf_path.empty()) {
+        pimpl->conn->Query("INSERT INTO attachments (item_id, ordinal, path) "
+                           + splitPdfPaths("(SELECT id, pdf_path FROM items WHERE id = '" + id + "')") + ";");
+        refreshPdfPaths("SELECT '" + id + "'");
+    }
+    assignCiteKeys({it.id});
+    notifyChange(DbChange::ItemInserted, it.id);
+    // Also add to item_collections
+    if (!it.collection.empty()) {
+        addItemToCollection(it.id, it.collection);
+    }
+}
+
+void Database::updateItem(const Item &it) {
+    ensureCollection(it.collection);
+    // Escape fields
+    std::string title = escapeSQL(it.title);
+    std::string authors = escapeSQL(it.authors);
+    std::string year = escapeSQL(it.year);
+    std::string doi = escapeSQL(it.doi);
+    std::string isbn = escapeSQL(it.isbn);
+    std::string type = escapeSQL(it.type);
+    std::string abstract = escapeSQL(it.abstract);
+    std::string address = escapeSQL(it.address);
+    std::string publisher = escapeSQL(it.publisher);
+    std::string editor = escapeSQL(it.editor);
+    std::string booktitle = escapeSQL(it.booktitle);
+    std::string series = escapeSQL(it.series);
+    std::string edition = escapeSQL(it.edition);
+    std::string chapter = escapeSQL(it.chapter);
+    std::string school = escapeSQL(it.school);
+    std::string institution = escapeSQL(it.institution);
+    std::string organization = escapeSQL(it.organization);
+    std::string howpublished = escapeSQL(it.howpublished);
+    std::string language = escapeSQL(it.language);
+    std::string journal = escapeSQL(it.journal);
+    std::string pages = escapeSQL(it.pages);
+    std::string volume = escapeSQL(it.volume);
+    std::string number = escapeSQL(it.number);
+    std::string keywords = escapeSQL(it.keywords);
+    std::string month = escapeSQL(it.month);
+    std::string url = escapeSQL(it.url);
+    std::string note = escapeSQL(it.note);
+    std::string extra = escapeSQL(it.extra);
+    std::string collectionEsc = escapeSQL(it.collection);
+    std::string doiNorm = escapeSQL(normalizeDOI(it.doi));
+    std::string isbn13 = escapeSQL(normalizeISBN(it.isbn));
+    std::string id = escapeSQL(it.id);
+
+    std::string sql = "UPDATE items SET title='" + title + "', authors='" + authors + "', year='" + year + "', doi='" + doi + "', isbn='" + isbn + "', type='" + type + "', abstract='" + abstract + "', address='" + address + "', publisher='" + publisher + "', editor='" + editor + "', booktitle='" + booktitle + "', series='" + series + "', edition='" + edition + "', chapter='" + chapter + "', school='" + school + "', institution='" + institution + "', organization='" + organization + "', howpublished='" + howpublished + "', language='" + language + "', journal='" + journal + "', pages='" + pages + "', volume='" + volume + "', number='" + number + "', keywords='" + keywords + "', month='" + month + "', url='" + url + "', note='" + note + "', extra='" + extra + "', collection='" + collectionEsc + "', doi_norm='" + doiNorm + "', isbn13='" + isbn13 + "', modified=current_timestamp WHERE id='" + id + "';";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError()) {
+        std::cerr << "DB update error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+    } else {
+        assignCiteKeys({it.id});
+        notifyChange(DbChange::ItemUpdated, it.id);
+    }
+}
+
+std::vector<Item> Database::listItems() {
+    std::vector<Item> out;
+        auto res = pimpl->conn->Query("SELECT id,title,authors,year,type,pdf_path FROM items ORDER BY title");
+    if (!res || res->HasError()) return out;
+    auto rows = res->RowCount();
+    for (size_t i = 0; i < rows; ++i) {
+        Item it;
+        it.id = res->GetValue(0, i).ToString();
+        it.title = res->GetValue(1, i).ToString();
+        it.authors = res->GetValue(2, i).ToString();
+        it.year = res->GetValue(3, i).ToString();
+        it.type = res->GetValue(4, i).ToString();
+        it.pdf_path = res->GetValue(5, i).ToString();
+        out.push_back(it);
+    }
+    return out;
+}
+
+std::vector<std::string> Database::listCollections() {
+    std::vector<std::string> out;
+    auto res = pimpl->conn->Query("SELECT name FROM collections ORDER BY name");
+    if (!res || res->HasError()) return out;
+    auto rows = res->RowCount();
+    for (size_t i = 0; i < rows; ++i) {
+        out.push_back(res->GetValue(0,i).ToString());
+    }
+    return out;
+}
+
+std::vector<CollectionNode> Database::listChildCollections(const std::string &parent) {
+    std::vector<CollectionNode> out;
+    auto &stmt = pimpl->childCollectionsStmt;
+    if (!stmt) {
+        // `rest` is the part of each name below the prefix; its first segment is the child
+        stmt = pimpl->conn->Prepare(
+            "SELECT split_part(rest, '/', 1) AS child, bool_or(length(rest) > length(split_part(rest, '/', 1)) + 1) "
+            "FROM (SELECT substr(name, length(CAST(? AS VARCHAR)) + 1) AS rest FROM collections WHERE starts_with(name, CAST(? AS VARCHAR))) "
+            "WHERE split_part(rest, '/', 1) <> '' GROUP BY child ORDER BY child");
+    }
+    if (!stmt || stmt->HasError()) {
+        std::cerr << "DB query error: " << (stmt ? stmt->GetError() : std::string("<no statement>")) << "\n";
+        stmt.reset();
+        return out;
+    }
+    const std::string prefix = parent.empty() ? std::string() : parent + "/";
+    auto res = stmt->Execute(prefix, prefix);
+    if (!res || res->HasError()) return out;
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            CollectionNode n;
+            n.name = valueToString(chunk->GetValue(0, r));
+            duckdb::Value deeper = chunk->GetValue(1, r);
+            n.hasChildren = !deeper.IsNull() && deeper.GetValue<bool>();
+            out.push_back(std::move(n));
+        }
+    }
+    return out;
+}
+
+std::vector<Item> Database::listItemsInCollection(const std::string &collection) {
+    std::vector<Item> out;
+    // Use item_collections join table to find items
+    // Include items from this collection AND all subcollections
+    std::string sql = "SELECT DISTINCT i.id,i.title,i.authors,i.year,i.doi,i.isbn,i.type,i.abstract,i.address,i.publisher,i.editor,i.booktitle,i.series,i.edition,i.chapter,i.school,i.institution,i.organization,i.howpublished,i.language,i.journal,i.pages,i.volume,i.number,i.keywords,i.month,i.url,i.note,i.extra,i.pdf_path,i.collection "
+                      "FROM items i JOIN item_collections ic ON i.id = ic.item_id "
+                      "WHERE ic.collection='" + collection + "' OR ic.collection LIKE '" + collection + "/%' ORDER BY i.title";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError()) return out;
+    auto rows = res->RowCount();
+    for (size_t i = 0; i < rows; ++i) {
+        Item it;
+        it.id = res->GetValue(0, i).ToString();
+        it.title = res->GetValue(1, i).ToString();
+        it.authors = res->GetValue(2, i).ToString();
+        it.year = res->GetValue(3, i).ToString();
+        it.doi = res->GetValue(4, i).ToString();
+        it.isbn = res->GetValue(5, i).ToString();
+        it.type = res->GetValue(6, i).ToString();
+        it.abstract = res->GetValue(7, i).ToString();
+        it.address = res->GetValue(8, i).ToString();
+        it.publisher = res->GetValue(9, i).ToString();
+        it.editor = res->GetValue(10, i).ToString();
+        it.booktitle = res->GetValue(11, i).ToString();
+        it.series = res->GetValue(12, i).ToString();
+        it.edition = res->GetValue(13, i).ToString();
+        it.chapter = res->GetValue(14, i).ToString();
+        it.school = res->GetValue(15, i).ToString();
+        it.institution = res->GetValue(16, i).ToString();
+        it.organization = res->GetValue(17, i).ToString();
+        it.howpublished = res->GetValue(18, i).ToString();
+        it.language = res->GetValue(19, i).ToString();
+        it.journal = res->GetValue(20, i).ToString();
+        it.pages = res->GetValue(21, i).ToString();
+        it.volume = res->GetValue(22, i).ToString();
+        it.number = res->GetValue(23, i).ToString();
+        it.keywords = res->GetValue(24, i).ToString();
+        it.month = res->GetValue(25, i).ToString();
+        it.url = res->GetValue(26, i).ToString();
+        it.note = res->GetValue(27, i).ToString();
+        it.extra = res->GetValue(28, i).ToString();
+        it.pdf_path = res->GetValue(29, i).ToString();
+        it.collection = res->GetValue(30, i).ToString();
+        out.push_back(it);
+    }
+    return out;
+}
+
+bool Database::getItem(const std::string &id, Item &out) {
+    std::string sql = "SELECT id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection,citekey FROM items WHERE id='" + id + "' LIMIT 1";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError() || res->RowCount() == 0) return false;
+    out.id = res->GetValue(0, 0).ToString();
+    out.title = res->GetValue(1, 0).ToString();
+    out.authors = res->GetValue(2, 0).ToString();
+    out.year = res->GetValue(3, 0).ToString();
+    out.doi = res->GetValue(4, 0).ToString();
+    out.isbn = res->GetValue(5, 0).ToString();
+    out.type = res->GetValue(6, 0).ToString();
+    out.abstract = res->GetValue(7, 0).ToString();
+    out.address = res->GetValue(8, 0).ToString();
+    out.publisher = res->GetValue(9, 0).ToString();
+    out.editor = res->GetValue(10, 0).ToString();
+    out.booktitle = res->GetValue(11, 0).ToString();
+    out.series = res->GetValue(12, 0).ToString();
+    out.edition = res->GetValue(13, 0).ToString();
+    out.chapter = res->GetValue(14, 0).ToString();
+    out.school = res->GetValue(15, 0).ToString();
+    out.institution = res->GetValue(16, 0).ToString();
+    out.organization = res->GetValue(17, 0).ToString();
+    out.howpublished = res->GetValue(18, 0).ToString();
+    out.language = res->GetValue(19, 0).ToString();
+    out.journal = res->GetValue(20, 0).ToString();
+    out.pages = res->GetValue(21, 0).ToString();
+    out.volume = res->GetValue(22, 0).ToString();
+    out.number = res->GetValue(23, 0).ToString();
+    out.keywords = res->GetValue(24, 0).ToString();
+    out.month = res->GetValue(25, 0).ToString();
+    out.url = res->GetValue(26, 0).ToString();
+    out.note = res->GetValue(27, 0).ToString();
+    out.extra = res->GetValue(28, 0).ToString();
+    out.pdf_path = res->GetValue(29, 0).ToString();
+    out.collection = res->GetValue(30, 0).ToString();
+    out.citekey = valueToString(res->GetValue(31, 0));
+    return true;
+}
+
+bool Database::findItemByDOI(const std::string &doi, Item &out) {
+    const std::string norm = normalizeDOI(doi);
+    if (norm.empty()) return false;
+    std::string sql = "SELECT id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection FROM items WHERE doi_norm='" + escapeSQL(norm) + "' LIMIT 1";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError() || res->RowCount() == 0) return false;
+    out.id = res->GetValue(0,0).ToString();
+    out.title = res->GetValue(1,0).ToString();
+    out.authors = res->GetValue(2,0).ToString();
+    out.year = res->GetValue(3,0).ToString();
+    out.doi = res->GetValue(4,0).ToString();
+    out.isbn = res->GetValue(5,0).ToString();
+    out.type = res->GetValue(6,0).ToString();
+    out.abstract = res->GetValue(7,0).ToString();
+    out.address = res->GetValue(8,0).ToString();
+    out.publisher = res->GetValue(9,0).ToString();
+    out.editor = res->GetValue(10,0).ToString();
+    out.booktitle = res->GetValue(11,0).ToString();
+    out.series = res->GetValue(12,0).ToString();
+    out.edition = res->GetValue(13,0).ToString();
+    out.chapter = res->GetValue(14,0).ToString();
+    out.school = res->GetValue(15,0).ToString();
+    out.institution = res->GetValue(16,0).ToString();
+    out.organization = res->GetValue(17,0).ToString();
+    out.howpublished = res->GetValue(18,0).ToString();
+    out.language = res->GetValue(19,0).ToString();
+    out.journal = res->GetValue(20,0).ToString();
+    out.pages = res->GetValue(21,0).ToString();
+    out.volume = res->GetValue(22,0).ToString();
+    out.number = res->GetValue(23,0).ToString();
+    out.keywords = res->GetValue(24,0).ToString();
+    out.month = res->GetValue(25,0).ToString();
+    out.url = res->GetValue(26,0).ToString();
+    out.note = res->GetValue(27,0).ToString();
+    out.extra = res->GetValue(28,0).ToString();
+    out.pdf_path = res->GetValue(29,0).ToString();
+    out.collection = res->GetValue(30,0).ToString();
+    return true;
+}
+
+bool Database::findItemByISBN(const std::string &isbn, Item &out) {
+    if (isbn.empty()) return false;
+    // Values that are not an ISBN-10/13 still match their exact spelling
+    const std::string norm = normalizeISBN(isbn);
+    const std::string where = norm.empty() ? "isbn='" + escapeSQL(isbn) + "'" : "isbn13='" + norm + "'";
+    std::string sql = "SELECT id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection FROM items WHERE " + where + " LIMIT 1";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError() || res->RowCount() == 0) return false;
+    out.id = res->GetValue(0,0).ToString();
+    out.title = res->GetValue(1,0).ToString();
+    out.authors = res->GetValue(2,0).ToString();
+    out.year = res->GetValue(3,0).ToString();
+    out.doi = res->GetValue(4,0).ToString();
+    out.isbn = res->GetValue(5,0).ToString();
+    out.type = res->GetValue(6,0).ToString();
+    out.abstract = res->GetValue(7,0).ToString();
+    out.address = res->GetValue(8,0).ToString();
+    out.publisher = res->GetValue(9,0).ToString();
+    out.editor = res->GetValue(10,0).ToString();
+    out.booktitle = res->GetValue(11,0).ToString();
+    out.series = res->GetValue(12,0).ToString();
+    out.edition = res->GetValue(13,0).ToString();
+    out.chapter = res->GetValue(14,0).ToString();
+    out.school = res->GetValue(15,0).ToString();
+    out.institution = res->GetValue(16,0).ToString();
+    out.organization = res->GetValue(17,0).ToString();
+    out.howpublished = res->GetValue(18,0).ToString();
+    out.language = res->GetValue(19,0).ToString();
+    out.journal = res->GetValue(20,0).ToString();
+    out.pages = res->GetValue(21,0).ToString();
+    out.volume = res->GetValue(22,0).ToString();
+    out.number = res->GetValue(23,0).ToString();
+    out.keywords = res->GetValue(24,0).ToString();
+    out.month = res->GetValue(25,0).ToString();
+    out.url = res->GetValue(26,0).ToString();
+    out.note = res->GetValue(27,0).ToString();
+    out.extra = res->GetValue(28,0).ToString();
+    out.pdf_path = res->GetValue(29,0).ToString();
+    out.collection = res->GetValue(30,0).ToString();
+    return true;
+}
+
+bool Database::findItemByTitleAndAuthor(const std::string &title, const std::string &authors, Item &out) {
+    if (title.empty() || authors.empty()) return false;
+    std::string sql = "SELECT id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection FROM items WHERE title='" + title + "' AND authors='" + authors + "' LIMIT 1";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError() || res->RowCount() == 0) return false;
+    out.id = res->GetValue(0,0).ToString();
+    out.title = res->GetValue(1,0).ToString();
+    out.authors = res->GetValue(2,0).ToString();
+    out.year = res->GetValue(3,0).ToString();
+    out.doi = res->GetValue(4,0).ToString();
+    out.isbn = res->GetValue(5,0).ToString();
+    out.type = res->GetValue(6,0).ToString();
+    out.abstract = res->GetValue(7,0).ToString();
+    out.address = res->GetValue(8,0).ToString();
+    out.publisher = res->GetValue(9,0).ToString();
+    out.editor = res->GetValue(10,0).ToString();
+    out.booktitle = res->GetValue(11,0).ToString();
+    out.series = res->GetValue(12,0).ToString();
+    out.edition = res->GetValue(13,0).ToString();
+    out.chapter = res->GetValue(14,0).ToString();
+    out.school = res->GetValue(15,0).ToString();
+    out.institution = res->GetValue(16,0).ToString();
+    out.organization = res->GetValue(17,0).ToString();
+    out.howpublished = res->GetValue(18,0).ToString();
+    out.language = res->GetValue(19,0).ToString();
+    out.journal = res->GetValue(20,0).ToString();
+    out.pages = res->GetValue(21,0).ToString();
+    out.volume = res->GetValue(22,0).ToString();
+    out.number = res->GetValue(23,0).ToString();
+    out.keywords = res->GetValue(24,0).ToString();
+    out.month = res->GetValue(25,0).ToString();
+    out.url = res->GetValue(26,0).ToString();
+    out.note = res->GetValue(27,0).ToString();
+    out.extra = res->GetValue(28,0).ToString();
+    out.pdf_path = res->GetValue(29,0).ToString();
+    out.collection = res->GetValue(30,0).ToString();
+    return true;
+}
+
+bool Database::findItemByTitleAndCollection(const std::string &title, const std::string &collection, Item &out) {
+    std::string sql = "SELECT id,title,authors,year,doi,isbn,type,abstract,address,publisher,editor,booktitle,series,edition,chapter,school,institution,organization,howpublished,language,journal,pages,volume,number,keywords,month,url,note,extra,pdf_path,collection FROM items WHERE title='" + title + "' AND collection='" + collection + "' LIMIT 1";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError() || res->RowCount() == 0) return false;
+    out.id = res->GetValue(0,0).ToString();
+    out.title = res->GetValue(1,0).ToString();
+    out.authors = res->GetValue(2,0).ToString();
+    out.year = res->GetValue(3,0).ToString();
+    out.doi = res->GetValue(4,0).ToString();
+    out.isbn = res->GetValue(5,0).ToString();
+    out.type = res->GetValue(6,0).ToString();
+    out.abstract = res->GetValue(7,0).ToString();
+    out.address = res->GetValue(8,0).ToString();
+    out.publisher = res->GetValue(9,0).ToString();
+    out.editor = res->GetValue(10,0).ToString();
+    out.booktitle = res->GetValue(11,0).ToString();
+    out.series = res->GetValue(12,0).ToString();
+    out.edition = res->GetValue(13,0).ToString();
+    out.chapter = res->GetValue(14,0).ToString();
+    out.school = res->GetValue(15,0).ToString();
+    out.institution = res->GetValue(16,0).ToString();
+    out.organization = res->GetValue(17,0).ToString();
+    out.howpublished = res->GetValue(18,0).ToString();
+    out.language = res->GetValue(19,0).ToString();
+    out.journal = res->GetValue(20,0).ToString();
+    out.pages = res->GetValue(21,0).ToString();
+    out.volume = res->GetValue(22,0).ToString();
+    out.number = res->GetValue(23,0).ToString();
+    out.keywords = res->GetValue(24,0).ToString();
+    out.month = res->GetValue(25,0).ToString();
+    out.url = res->GetValue(26,0).ToString();
+    out.note = res->GetValue(27,0).ToString();
+    out.extra = res->GetValue(28,0).ToString();
+    out.pdf_path = res->GetValue(29,0).ToString();
+    out.collection = res->GetValue(30,0).ToString();
+    return true;
+}
+
+void Database::renameCollection(const std::string &oldName, const std::string &newName) {
+    if (oldName.empty() || newName.empty() || oldName == newName) return;
+    try {
+        // Use a transaction to ensure all operations succeed or fail together
+        beginTransaction();
+        
+        // First, rename the collection itself
+        auto stmt1 = pimpl->conn->Prepare("UPDATE collections SET name = ? WHERE name = ?");
+        stmt1->Execute(newName, oldName);
+        
+        // Then, rename items in this collection
+        auto stmt2 = pimpl->conn->Prepare("UPDATE items SET collection = ? WHERE collection = ?");
+        stmt2->Execute(newName, oldName);
+        
+        // For subcollections, use a simple approach: get all collections first
+        auto allCollections = listCollections();
+        std::string oldPrefix = oldName + "/";
+        std::string newPrefix = newName + "/";
+        
+        for (const auto& collName : allCollections) {
+            if (collName.length() > oldPrefix.length() && 
+                collName.substr(0, oldPrefix.length()) == oldPrefix) {
+                // This is a subcollection that needs to be renamed
+                std::string newCollName = newPrefix + collName.substr(oldPrefix.length());
+                
+                auto updateStmt = pimpl->conn->Prepare("UPDATE collections SET name = ? WHERE name = ?");
+                updateStmt->Execute(newCollName, collName);
+                
+                // Also update items in this subcollection
+                auto updateItemsStmt = pimpl->conn->Prepare("UPDATE items SET collection = ? WHERE collection = ?");
+                updateItemsStmt->Execute(newCollName, collName);
+            }
+        }
+
+        // Linked .bib files and live exports follow their collection
+        for (const char *table : {"linked_bibs", "live_exports"}) {
+            auto follow = pimpl->conn->Prepare(std::string("UPDATE ") + table + " SET collection = ? || substr(collection, ?) "
+                                               "WHERE collection = ? OR starts_with(collection, ?)");
+            follow->Execute(newName, (int64_t)oldName.size() + 1, oldName, oldPrefix);
+        }
+        
+        commitTransaction();
+        notifyChange(DbChange::CollectionRenamed, oldName, newName);
+        
+    } catch (const std::exception &e) {
+        try {
+            rollbackTransaction();
+        } catch (...) {}
+    }
+}
+
+void Database::deleteCollection(const std::string &name) {
+    if (name.empty()) return;
+    try {
+        // Use a transaction to ensure all operations succeed or fail together
+        beginTransaction();
+        
+        // First, delete the collection itself
+        auto stmt1 = pimpl->conn->Prepare("DELETE FROM collections WHERE name=?");
+        stmt1->Execute(name);
+        
+        // Move items in this collection back to root (empty collection)
+        auto stmt2 = pimpl->conn->Prepare("UPDATE items SET collection='' WHERE collection=?");
+        stmt2->Execute(name);
+        
+        // Handle subcollections - delete any collections that start with "name/"
+        auto allCollections = listCollections();
+        std::string prefix = name + "/";
+        
+        for (const auto& collName : allCollections) {
+            if (collName.length() > prefix.length() && 
+                collName.substr(0, prefix.length()) == prefix) {
+                // This is a subcollection that needs to be deleted
+                auto deleteStmt = pimpl->conn->Prepare("DELETE FROM collections WHERE name=?");
+                deleteStmt->Execute(collName);
+                
+                // Move items in this subcollection back to root
+                auto deleteItemsStmt = pimpl->conn->Prepare("UPDATE items SET collection='' WHERE collection=?");
+                deleteItemsStmt->Execute(collName);
+            }
+        }
+        
+        commitTransaction();
+        notifyChange(DbChange::CollectionDeleted, name);
+        
+    } catch (const std::exception &e) {
+        try {
+            rollbackTransaction();
+        } catch (...) {}
+    }
+}
+
+void Database::addCollection(const std::string &name) {
+    if (name.empty()) return;
+    try {
+        ensureCollection(name);
+    } catch (const std::exception &e) {
+        // Handle error silently for now
+    }
+}
+
+void Database::deleteItem(const std::string &id) {
+    if (id.empty()) return;
+    // Attachment files in the storage directory that no other item refers to go with the item
+    std::vector<std::string> files;
+    const std::string eid = escapeSQL(id);
+    auto res = pimpl->conn->Query("SELECT DISTINCT path FROM attachments WHERE item_id='" + eid + "' AND path NOT IN "
+                                  "(SELECT path FROM attachments WHERE item_id<>'" + eid + "')");
+    if (res && !res->HasError()) {
+        for (size_t i = 0; i < res->RowCount(); ++i) {
+            std::string path = valueToString(res->GetValue(0, i));
+            if (inAttachmentStorage(path)) files.push_back(std::move(path));
+        }
+    }
+    // Remove from item_collections and attachments first; files go only once the item is gone
+    auto &conn = *pimpl->conn;
+    beginTransaction();
+    conn.Query("DELETE FROM item_collections WHERE item_id='" + eid + "'");
+    conn.Query("DELETE FROM attachments WHERE item_id='" + eid + "'");
+    auto del = conn.Query("DELETE FROM items WHERE id='" + eid + "'");
+    if (!del || del->HasError()) {
+        std::cerr << "DB delete error: " << (del ? del->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        return;
+    }
+    const bool deleted = affectedRows(*del) > 0;
+    const bool committed = commitTransaction();
+    if (!deleted || !committed) return;
+    for (const auto &f : files) {
+        std::error_code ec;
+        fs::remove(f, ec);
+    }
+    notifyChange(DbChange::ItemDeleted, id);
+}
+
+void Database::addItemToCollection(const std::string &itemId, const std::string &collection) {
+    if (itemId.empty() || collection.empty()) return;
+    try {
+        // Ensure collection exists
+        ensureCollection(collection);
+        // Add to item_collections (ignore if already exists)
+        pimpl->conn->Query("INSERT OR IGNORE INTO item_collections (item_id, collection) VALUES ('" + itemId + "', '" + collection + "')");
+        // Update the primary collection field (for backward compatibility, use first collection)
+        auto colls = getItemCollections(itemId);
+        if (!colls.empty()) {
+            pimpl->conn->Query("UPDATE items SET collection='" + colls[0] + "', modified=current_timestamp WHERE id='" + itemId + "'");
+        }
+        notifyChange(DbChange::ItemUpdated, itemId);
+    } catch (...) {}
+}
+
+void Database::removeItemFromCollection(const std::string &itemId, const std::string &collection) {
+    if (itemId.empty() || collection.empty()) return;
+    try {
+        pimpl->conn->Query("DELETE FROM item_collections WHERE item_id='" + itemId + "' AND collection='" + collection + "'");
+        // Update the primary collection field (for backward compatibility)
+        auto colls = getItemCollections(itemId);
+        std::string newPrimary = colls.empty() ? "" : colls[0];
+        pimpl->conn->Query("UPDATE items SET collection='" + newPrimary + "', modified=current_timestamp WHERE id='" + itemId + "'");
+        notifyChange(DbChange::ItemUpdated, itemId);
+    } catch (...) {}
+}
+
+std::vector<std::string> Database::getItemCollections(const std::string &itemId) {
+    std::vector<std::string> out;
+    if (itemId.empty()) return out;
+    auto res = pimpl->conn->Query("SELECT collection FROM item_collections WHERE item_id='" + itemId + "' ORDER BY collection");
+    if (!res || res->HasError()) return out;
+    auto rows = res->RowCount();
+    for (size_t i = 0; i < rows; ++i) {
+        out.push_back(res->GetValue(0, i).ToString());
+    }
+    return out;
+}
+
+void Database::addItems(const std::vector<Item> &items) {
+    if (items.empty()) return;
+    auto &conn = *pimpl->conn;
+    if (!stageItems(conn, "bulk_items", items)) return;
+    const std::string cols = itemColumnList();
+    beginTransaction();
+    auto res = conn.Query("INSERT INTO items (" + cols + ",doi_norm,isbn13,modified) SELECT " + cols + ",doi_norm,isbn13,current_timestamp FROM bulk_items;");
+    if (!res || res->HasError()) {
+        std::cerr << "DB bulk insert error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS bulk_items;");
+        return;
+    }
+    const std::vector<std::string> newColls = insertCollections(conn, "SELECT DISTINCT collection FROM bulk_items "
+                                                                "WHERE collection <> '' AND collection NOT IN (SELECT name FROM collections)");
+    conn.Query("INSERT OR IGNORE INTO item_collections (item_id, collection) "
+               "SELECT id, collection FROM bulk_items WHERE collection <> '';");
+    conn.Query("INSERT INTO attachments (item_id, ordinal, path) " + splitPdfPaths("bulk_items") + ";");
+    refreshPdfPaths("SELECT id FROM bulk_items WHERE COALESCE(pdf_path, '') <> ''");
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS bulk_items;");
+    assignCiteKeys(itemIds(items));
+    for (const auto &name : newColls) notifyChange(DbChange::CollectionAdded, name);
+    for (const auto &it : items) notifyChange(DbChange::ItemInserted, it.id);
+}
+
+void Database::addItemsToCollections(const std::vector<std::pair<std::string, std::string>> &memberships) {
+    if (memberships.empty()) return;
+    auto &conn = *pimpl->conn;
+    auto res = conn.Query("CREATE OR REPLACE TEMP TABLE bulk_memberships (item_id TEXT, collection TEXT);");
+    if (!res || res->HasError()) {
+        std::cerr << "DB staging error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return;
+    }
+    try {
+        duckdb::Appender appender(conn, "bulk_memberships");
+        for (const auto &m : memberships) {
+            if (m.first.empty() || m.second.empty()) continue;
+            appender.AppendRow(duckdb::Value(m.first), duckdb::Value(m.second));
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB staging append error: " << e.what() << "\n";
+        return;
+    }
+    beginTransaction();
+    const std::vector<std::string> newColls = insertCollections(conn, "SELECT DISTINCT collection FROM bulk_memberships "
+                                                                "WHERE collection NOT IN (SELECT name FROM collections)");
+    auto ins = conn.Query("INSERT OR IGNORE INTO item_collections (item_id, collection) "
+                          "SELECT DISTINCT item_id, collection FROM bulk_memberships;");
+    if (!ins || ins->HasError()) {
+        std::cerr << "DB bulk membership error: " << (ins ? ins->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS bulk_memberships;");
+        return;
+    }
+    // Like addItemToCollection, an item without a primary collection takes the first by name
+    conn.Query("UPDATE items SET collection = m.collection, modified = current_timestamp "
+               "FROM (SELECT item_id, min(collection) AS collection FROM bulk_memberships GROUP BY item_id) m "
+               "WHERE items.id = m.item_id AND coalesce(items.collection, '') = '';");
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS bulk_memberships;");
+    for (const auto &name : newColls) notifyChange(DbChange::CollectionAdded, name);
+    std::string last;
+    for (const auto &m : memberships) {
+        if (m.first != last) notifyChange(DbChange::ItemUpdated, m.first);
+        last = m.first;
+    }
+}
+
+bool Database::isItemColumn(const std::string &name) {
+    return std::any_of(kItemFields.begin(), kItemFields.end(), [&](const auto &f) { return name == f.first; });
+}
+
+void Database::ensureCollection(const std::string &name) {
+    if (name.empty()) return;
+    auto &stmt = pimpl->ensureCollectionStmt;
+    if (!stmt) stmt = pimpl->conn->Prepare("INSERT INTO collections (name) SELECT ? WHERE NOT EXISTS (SELECT 1 FROM collections WHERE name = ?)");
+    if (!stmt || stmt->HasError()) return;
+    auto res = stmt->Execute(name, name);
+    if (res && affectedRows(*res) > 0) notifyChange(DbChange::CollectionAdded, name);
+}
+
+bool Database::patchItem(const std::string &id, const std::map<std::string, std::string> &fields) {
+    if (fields.empty()) return true;
+    for (const auto &f : fields) {
+        if (f.first == "id" || f.first == "pdf_path" || !isItemColumn(f.first)) {
+            std::cerr << "DB patch error: unknown column " << f.first << "\n";
+            return false;
+        }
+    }
+    // Normalized identifiers follow their source columns
+    std::map<std::string, std::string> columns = fields;
+    auto doi = fields.find("doi");
+    if (doi != fields.end()) columns["doi_norm"] = normalizeDOI(doi->second);
+    auto isbn = fields.find("isbn");
+    if (isbn != fields.end()) columns["isbn13"] = normalizeISBN(isbn->second);
+
+    // std::map iterates in key order, so the same column set always yields the same key
+    std::string key;
+    duckdb::vector<duckdb::Value> params;
+    for (const auto &f : columns) {
+        key += f.first + ",";
+        params.push_back(duckdb::Value(f.second));
+    }
+    params.push_back(duckdb::Value(id));
+
+    auto &stmt = pimpl->patchStatements[key];
+    if (!stmt) {
+        std::string assignments;
+        for (const auto &f : columns) assignments += f.first + " = ?, ";
+        stmt = pimpl->conn->Prepare("UPDATE items SET " + assignments + "modified = current_timestamp WHERE id = ?");
+    }
+    if (!stmt || stmt->HasError()) {
+        std::cerr << "DB patch error: " << (stmt ? stmt->GetError() : std::string("<no statement>")) << "\n";
+        pimpl->patchStatements.erase(key);
+        return false;
+    }
+    auto coll = fields.find("collection");
+    if (coll != fields.end()) ensureCollection(coll->second);
+    auto res = stmt->Execute(params, false);
+    if (!res || res->HasError()) {
+        std::cerr << "DB patch error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return false;
+    }
+    if (fields.count("authors") || fields.count("title") || fields.count("year")) assignCiteKeys({id});
+    notifyChange(DbChange::ItemUpdated, id);
+    return true;
+}
+
+bool Database::getItemField(const std::string &id, const std::string &column, std::string &out) {
+    if (!isItemColumn(column)) return false;
+    auto &stmt = pimpl->fieldStatements[column];
+    if (!stmt) stmt = pimpl->conn->Prepare("SELECT " + column + " FROM items WHERE id = ?");
+    if (!stmt || stmt->HasError()) { pimpl->fieldStatements.erase(column); return false; }
+    auto res = stmt->Execute(id);
+    if (!res || res->HasError()) return false;
+    auto chunk = res->Fetch();
+    if (!chunk || chunk->size() == 0) return false;
+    out = valueToString(chunk->GetValue(0, 0));
+    return true;
+}
+
+void Database::updateItems(const std::vector<Item> &items) {
+    if (items.empty()) return;
+    auto &conn = *pimpl->conn;
+    if (!stageItems(conn, "bulk_updates", items)) return;
+    std::string assignments;
+    for (const auto &f : kItemFields) {
+        // pdf_path follows the attachments table
+        if (std::string(f.first) == "id" || std::string(f.first) == "pdf_path") continue;
+        if (!assignments.empty()) assignments += ", ";
+        assignments += std::string(f.first) + " = u." + f.first;
+    }
+    beginTransaction();
+    auto res = conn.Query("UPDATE items SET " + assignments + ", doi_norm = u.doi_norm, isbn13 = u.isbn13, modified = current_timestamp "
+                          "FROM bulk_updates u WHERE items.id = u.id;");
+    if (!res || res->HasError()) {
+        std::cerr << "DB bulk update error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS bulk_updates;");
+        return;
+    }
+    const std::vector<std::string> newColls = insertCollections(conn, "SELECT DISTINCT collection FROM bulk_updates "
+                                                                "WHERE collection <> '' AND collection NOT IN (SELECT name FROM collections)");
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS bulk_updates;");
+    assignCiteKeys(itemIds(items));
+    for (const auto &name : newColls) notifyChange(DbChange::CollectionAdded, name);
+    for (const auto &it : items) notifyChange(DbChange::ItemUpdated, it.id);
+}
+
+std::vector<Item> Database::getItems(const std::vector<std::string> &ids) {
+    std::vector<Item> out;
+    if (ids.empty()) return out;
+    std::string inList;
+    for (const auto &id : ids) {
+        if (!inList.empty()) inList += ",";
+        inList += "'" + escapeSQL(id) + "'";
+    }
+    auto res = pimpl->conn->Query("SELECT " + itemColumnList() + ", citekey FROM items WHERE id IN (" + inList + ")");
+    if (!res || res->HasError()) return out;
+    out.reserve(res->RowCount());
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            Item it;
+            itemFromChunk(*chunk, r, it);
+            it.citekey = valueToString(chunk->GetValue(kItemFields.size(), r));
+            out.push_back(std::move(it));
+        }
+    }
+    return out;
+}
+
+std::vector<std::string> Database::findExistingItems(const std::vector<Item> &candidates) {
+    std::vector<std::string> out(candidates.size());
+    if (candidates.empty()) return out;
+    auto &conn = *pimpl->conn;
+    auto res = conn.Query("CREATE OR REPLACE TEMP TABLE match_candidates (idx INTEGER, doi TEXT, isbn TEXT, title TEXT, authors TEXT);");
+    if (!res || res->HasError()) return out;
+    try {
+        duckdb::Appender appender(conn, "match_candidates");
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const Item &c = candidates[i];
+            appender.AppendRow((int32_t)i, duckdb::Value(normalizeDOI(c.doi)), duckdb::Value(normalizeISBN(c.isbn)),
+                               duckdb::Value(c.title), duckdb::Value(c.authors));
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB match staging error: " << e.what() << "\n";
+        return out;
+    }
+    // One set-based pass: same precedence as the single-item lookups (DOI, ISBN, title+authors)
+    auto m = conn.Query(
+        "SELECT c.idx, COALESCE(d.id, b.id, t.id) FROM match_candidates c "
+        "LEFT JOIN (SELECT doi_norm, min(id) AS id FROM items WHERE doi_norm <> '' GROUP BY doi_norm) d ON c.doi <> '' AND d.doi_norm = c.doi "
+        "LEFT JOIN (SELECT isbn13, min(id) AS id FROM items WHERE isbn13 <> '' GROUP BY isbn13) b ON c.isbn <> '' AND b.isbn13 = c.isbn "
+        "LEFT JOIN (SELECT lower(trim(title)) AS title, lower(trim(authors)) AS authors, min(id) AS id FROM items "
+        "WHERE trim(title) <> '' AND trim(authors) <> '' GROUP BY ALL) t "
+        "ON t.title = lower(trim(c.title)) AND t.authors = lower(trim(c.authors));");
+    if (m && !m->HasError()) {
+        for (size_t r = 0; r < m->RowCount(); ++r) {
+            auto idxVal = m->GetValue(0, r);
+            if (idxVal.IsNull()) continue;
+            int64_t idx = idxVal.GetValue<int64_t>();
+            if (idx >= 0 && (size_t)idx < out.size()) out[idx] = valueToString(m->GetValue(1, r));
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS match_candidates;");
+    return out;
+}
+
+// Escape LIKE wildcards so user text matches literally (used with ESCAPE '\')
+static std::string escapeLike(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        if (c == '%' || c == '_' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+void Database::queryItems(const ItemQuery &q, const std::function<void(const std::vector<Item>&)> &onChunk) {
+    auto &conn = *pimpl->conn;
+    std::string sql = "SELECT " + itemColumnList("i.") + ", CAST(i.modified AS VARCHAR), i.citekey FROM items i WHERE 1=1";
+    duckdb::vector<duckdb::Value> params;
+    if (!q.collection.empty()) {
+        sql += " AND i.id IN (SELECT item_id FROM item_collections WHERE collection = ? OR collection LIKE ? ESCAPE '\\')";
+        params.emplace_back(q.collection);
+        params.emplace_back(escapeLike(q.collection) + "/%");
+    }
+    if (!q.search.empty()) {
+        sql += " AND (i.title ILIKE ? ESCAPE '\\' OR i.authors ILIKE ? ESCAPE '\\' OR i.doi ILIKE ? ESCAPE '\\' OR i.isbn ILIKE ? ESCAPE '\\')";
+        const std::string pattern = "%" + escapeLike(q.search) + "%";
+        for (int k = 0; k < 4; ++k) params.emplace_back(pattern);
+    }
+    if (!q.since.empty()) {
+        sql += " AND i.modified > TRY_CAST(? AS TIMESTAMP)";
+        params.emplace_back(q.since);
+    }
+    if (!q.cursor.empty()) {
+        // Keyset pagination on (title, id): resume strictly after the cursor item
+        sql += " AND (COALESCE(i.title, '') > COALESCE((SELECT title FROM items WHERE id = ?), '')"
+               " OR (COALESCE(i.title, '') = COALESCE((SELECT title FROM items WHERE id = ?), '') AND i.id > ?))";
+        params.emplace_back(q.cursor);
+        params.emplace_back(q.cursor);
+        params.emplace_back(q.cursor);
+    }
+    sql += " ORDER BY COALESCE(i.title, ''), i.id";
+    if (q.limit > 0) sql += " LIMIT " + std::to_string(q.limit);
+    if (q.offset > 0) sql += " OFFSET " + std::to_string(q.offset);
+
+    auto stmt = conn.Prepare(sql);
+    if (!stmt || stmt->HasError()) {
+        std::cerr << "DB query error: " << (stmt ? stmt->GetError() : std::string("<no statement>")) << "\n";
+        return;
+    }
+    auto res = stmt->Execute(params, true);
+    if (!res || res->HasError()) return;
+    std::vector<Item> batch;
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        batch.clear();
+        batch.reserve(chunk->size());
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            Item it;
+            itemFromChunk(*chunk, r, it);
+            it.modified = valueToString(chunk->GetValue(kItemFields.size(), r));
+            it.citekey = valueToString(chunk->GetValue(kItemFields.size() + 1, r));
+            batch.push_back(std::move(it));
+        }
+        onChunk(batch);
+    }
+}
+
+void Database::assignCiteKeys(const std::vector<std::string> &ids) {
+    auto &conn = *pimpl->conn;
+    std::string sql = "SELECT id, authors, title, year, citekey, citekey_base FROM items WHERE ";
+    if (ids.empty()) {
+        sql += "citekey IS NULL";
+    } else if (ids.size() == 1) {
+        // Single-item writes (updateItem, patchItem): one lookup, nothing staged when the key still fits
+        sql += "id = '" + escapeSQL(ids[0]) + "'";
+    } else {
+        std::vector<std::vector<std::string>> rows;
+        rows.reserve(ids.size());
+        for (const auto &id : ids) rows.push_back({id});
+        if (!stageText(conn, "cite_targets", {"id"}, rows)) return;
+        sql += "id IN (SELECT id FROM cite_targets)";
+    }
+
+    // Items needing a (new) key: the stored one is missing or was derived from
+    // different authors/title/year
+    struct Pending { std::string id, base, key; };
+    std::vector<Pending> pending;
+    std::unordered_set<std::string> bases;
+    auto res = conn.Query(sql);
+    if (res && !res->HasError()) {
+        while (auto chunk = res->Fetch()) {
+            if (chunk->size() == 0) break;
+            for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+                Item probe;
+                probe.authors = valueToString(chunk->GetValue(1, r));
+                probe.title = valueToString(chunk->GetValue(2, r));
+                probe.year = valueToString(chunk->GetValue(3, r));
+                std::string base = citeKeyBase(probe);
+                if (!valueToString(chunk->GetValue(4, r)).empty() && valueToString(chunk->GetValue(5, r)) == base) continue;
+                bases.insert(base);
+                pending.push_back({valueToString(chunk->GetValue(0, r)), std::move(base), std::string()});
+            }
+        }
+    }
+    if (ids.size() > 1) conn.Query("DROP TABLE IF EXISTS cite_targets;");
+    if (pending.empty()) return;
+
+    // Every key already held under one of these bases, or equal to one of them
+    std::unordered_set<std::string> taken;
+    std::vector<std::vector<std::string>> baseRows;
+    baseRows.reserve(bases.size());
+    for (const auto &b : bases) baseRows.push_back({b});
+    if (!stageText(conn, "cite_bases", {"base"}, baseRows)) return;
+    auto held = conn.Query("SELECT citekey FROM items WHERE citekey IS NOT NULL AND "
+                           "(citekey_base IN (SELECT base FROM cite_bases) OR citekey IN (SELECT base FROM cite_bases));");
+    if (held && !held->HasError()) {
+        while (auto chunk = held->Fetch()) {
+            if (chunk->size() == 0) break;
+            for (duckdb::idx_t r = 0; r < chunk->size(); ++r) taken.insert(valueToString(chunk->GetValue(0, r)));
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS cite_bases;");
+
+    std::unordered_map<std::string, size_t> nextSuffix;
+    auto allocate = [&](Pending &p) {
+        size_t &n = nextSuffix[p.base];
+        do { p.key = p.base + citeKeySuffix(n++); } while (taken.count(p.key));
+        taken.insert(p.key);
+    };
+    for (auto &p : pending) allocate(p);
+
+    // A suffixed key can still equal a key derived from another base
+    // ("smith_deep" + "a" vs. a title starting with "Deepa"); retry those until
+    // nothing in the table collides.
+    for (;;) {
+        std::vector<std::vector<std::string>> rows;
+        rows.reserve(pending.size());
+        for (const auto &p : pending) rows.push_back({p.id, p.key, p.base});
+        if (!stageText(conn, "cite_assign", {"id", "citekey", "base"}, rows)) return;
+        auto clash = conn.Query("SELECT a.id FROM cite_assign a JOIN items i ON i.citekey = a.citekey AND i.id <> a.id;");
+        if (!clash || clash->HasError() || clash->RowCount() == 0) break;
+        std::unordered_set<std::string> clashing;
+        for (size_t r = 0; r < clash->RowCount(); ++r) clashing.insert(valueToString(clash->GetValue(0, r)));
+        for (auto &p : pending) {
+            if (clashing.count(p.id)) allocate(p);
+        }
+    }
+    auto upd = conn.Query("UPDATE items SET citekey = a.citekey, citekey_base = a.base FROM cite_assign a WHERE items.id = a.id;");
+    if (!upd || upd->HasError()) {
+        std::cerr << "DB citekey error: " << (upd ? upd->GetError() : std::string("<no result>")) << "\n";
+    }
+    conn.Query("DROP TABLE IF EXISTS cite_assign;");
+}
+
+void Database::normalizeIdentifiers() {
+    auto &conn = *pimpl->conn;
+    // Rows written before doi_norm/isbn13 existed; every write path fills both
+    for (;;) {
+        auto page = conn.Query("SELECT id, doi, isbn FROM items WHERE doi_norm IS NULL OR isbn13 IS NULL LIMIT 50000;");
+        if (!page || page->HasError() || page->RowCount() == 0) break;
+        std::vector<std::vector<std::string>> rows;
+        rows.reserve(page->RowCount());
+        for (size_t r = 0; r < page->RowCount(); ++r) {
+            rows.push_back({valueToString(page->GetValue(0, r)), normalizeDOI(valueToString(page->GetValue(1, r))),
+                            normalizeISBN(valueToString(page->GetValue(2, r)))});
+        }
+        if (!stageText(conn, "norm_ids", {"id", "doi_norm", "isbn13"}, rows)) break;
+        auto upd = conn.Query("UPDATE items SET doi_norm = n.doi_norm, isbn13 = n.isbn13 FROM norm_ids n WHERE items.id = n.id;");
+        if (!upd || upd->HasError() || affectedRows(*upd) == 0) {
+            std::cerr << "DB identifier backfill error: " << (upd ? upd->GetError() : std::string("<no result>")) << "\n";
+            break;
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS norm_ids;");
+}
+
+// Items indexed per page by refreshDuplicateIndex
+static const size_t kLshPageSize = 20000;
+// Largest LSH bucket still expanded into candidate pairs. Bigger ones come from
+// generic titles ("Introduction") and would make the self-join quadratic; real
+// duplicates among them still meet in the bands that include an author.
+static const int kMaxLshBucket = 200;
+
+void Database::refreshDuplicateIndex() {
+    auto &conn = *pimpl->conn;
+    beginTransaction();
+    // Forget items deleted or modified since they were indexed
+    conn.Query("CREATE OR REPLACE TEMP TABLE lsh_stale AS SELECT s.item_id FROM item_lsh_state s "
+               "LEFT JOIN items i ON i.id = s.item_id WHERE i.id IS NULL OR i.modified IS DISTINCT FROM s.modified;");
+    conn.Query("DELETE FROM item_lsh WHERE item_id IN (SELECT item_id FROM lsh_stale);");
+    conn.Query("DELETE FROM item_lsh_state WHERE item_id IN (SELECT item_id FROM lsh_stale);");
+    conn.Query("DROP TABLE IF EXISTS lsh_stale;");
+
+    // Index everything else not in item_lsh_state, a page at a time in id order
+    std::string last;
+    for (;;) {
+        auto page = conn.Query("SELECT id, title, authors FROM items WHERE id > '" + escapeSQL(last) +
+                               "' AND id NOT IN (SELECT item_id FROM item_lsh_state) ORDER BY id LIMIT " + std::to_string(kLshPageSize) + ";");
+        if (!page || page->HasError() || page->RowCount() == 0) break;
+        std::vector<std::vector<std::string>> ids;
+        ids.reserve(page->RowCount());
+        try {
+            duckdb::Appender appender(conn, "item_lsh");
+            for (size_t r = 0; r < page->RowCount(); ++r) {
+                Item probe;
+                probe.id = valueToString(page->GetValue(0, r));
+                probe.title = valueToString(page->GetValue(1, r));
+                probe.authors = valueToString(page->GetValue(2, r));
+                ids.push_back({probe.id});
+                auto tokens = dedupeTokens(probe);
+                if (tokens.empty()) continue;
+                auto buckets = lshBuckets(minHashSignature(tokens));
+                for (int b = 0; b < kMinHashBands; ++b) {
+                    appender.AppendRow(duckdb::Value(probe.id), duckdb::Value::INTEGER(b), duckdb::Value::BIGINT(buckets[b]));
+                }
+            }
+            appender.Close();
+        } catch (std::exception &e) {
+            std::cerr << "DB duplicate index error: " << e.what() << "\n";
+            rollbackTransaction();
+            return;
+        }
+        last = ids.back()[0];
+        if (!stageText(conn, "lsh_page", {"id"}, ids)) break;
+        conn.Query("INSERT INTO item_lsh_state SELECT id, modified FROM items WHERE id IN (SELECT id FROM lsh_page);");
+    }
+    conn.Query("DROP TABLE IF EXISTS lsh_page;");
+    commitTransaction();
+}
+
+std::vector<DuplicateCluster> Database::findDuplicateClusters(double threshold) {
+    std::vector<DuplicateCluster> out;
+    refreshDuplicateIndex();
+    auto &conn = *pimpl->conn;
+    // Candidate pairs: items sharing a bucket in at least one band
+    auto pairs = conn.Query(
+        "WITH shared AS (SELECT band, bucket FROM item_lsh GROUP BY band, bucket HAVING count(*) BETWEEN 2 AND " + std::to_string(kMaxLshBucket) + "), "
+        "hits AS (SELECT l.item_id, l.band, l.bucket FROM item_lsh l JOIN shared s ON l.band = s.band AND l.bucket = s.bucket) "
+        "SELECT DISTINCT a.item_id, b.item_id FROM hits a JOIN hits b ON a.band = b.band AND a.bucket = b.bucket AND a.item_id < b.item_id;");
+    if (!pairs || pairs->HasError()) {
+        std::cerr << "DB duplicate query error: " << (pairs ? pairs->GetError() : std::string("<no result>")) << "\n";
+        return out;
+    }
+    std::unordered_map<std::string, size_t> index;
+    std::vector<std::string> ids;
+    auto indexOf = [&](const std::string &id) {
+        auto ins = index.emplace(id, ids.size());
+        if (ins.second) ids.push_back(id);
+        return ins.first->second;
+    };
+    std::vector<std::pair<size_t, size_t>> candidates;
+    while (auto chunk = pairs->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            size_t a = indexOf(valueToString(chunk->GetValue(0, r)));
+            candidates.emplace_back(a, indexOf(valueToString(chunk->GetValue(1, r))));
+        }
+    }
+    if (candidates.empty()) return out;
+
+    // Confirm each candidate pair on the exact token sets
+    std::vector<std::vector<uint64_t>> tokens(ids.size());
+    std::vector<std::string> modified(ids.size());
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(ids.size());
+    for (const auto &id : ids) rows.push_back({id});
+    if (!stageText(conn, "dup_candidates", {"id"}, rows)) return out;
+    auto res = conn.Query("SELECT id, title, authors, CAST(modified AS VARCHAR) FROM items WHERE id IN (SELECT id FROM dup_candidates);");
+    if (res && !res->HasError()) {
+        while (auto chunk = res->Fetch()) {
+            if (chunk->size() == 0) break;
+            for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+                Item probe;
+                probe.title = valueToString(chunk->GetValue(1, r));
+                probe.authors = valueToString(chunk->GetValue(2, r));
+                size_t i = index[valueToString(chunk->GetValue(0, r))];
+                tokens[i] = dedupeTokens(probe);
+                modified[i] = valueToString(chunk->GetValue(3, r));
+            }
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS dup_candidates;");
+
+    // Union-find over the confirmed pairs; each root tracks its weakest link
+    std::vector<size_t> parent(ids.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<double> weakest(ids.size(), 1.0);
+    auto find = [&](size_t x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    for (const auto &c : candidates) {
+        double sim = tokenJaccard(tokens[c.first], tokens[c.second]);
+        if (sim < threshold) continue;
+        size_t a = find(c.first), b = find(c.second);
+        if (a == b) continue; // already in the same cluster: this pair joins nothing
+        parent[b] = a;
+        weakest[a] = std::min({weakest[a], weakest[b], sim});
+    }
+    std::unordered_map<size_t, size_t> clusterOf;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        size_t root = find(i);
+        auto ins = clusterOf.emplace(root, out.size());
+        if (ins.second) out.push_back({{}, weakest[root]});
+        out[ins.first->second].ids.push_back(ids[i]);
+    }
+    out.erase(std::remove_if(out.begin(), out.end(), [](const DuplicateCluster &c) { return c.ids.size() < 2; }), out.end());
+    for (auto &c : out) {
+        std::sort(c.ids.begin(), c.ids.end(), [&](const std::string &a, const std::string &b) {
+            const std::string &ma = modified[index[a]], &mb = modified[index[b]];
+            return ma != mb ? ma < mb : a < b;
+        });
+    }
+    std::sort(out.begin(), out.end(), [](const DuplicateCluster &a, const DuplicateCluster &b) {
+        return a.ids.size() != b.ids.size() ? a.ids.size() > b.ids.size() : a.ids.front() < b.ids.front();
+    });
+    return out;
+}
+
+bool Database::mergeItems(const Item &merged, const std::vector<std::string> &duplicates) {
+    auto &conn = *pimpl->conn;
+    std::vector<std::vector<std::string>> rows;
+    for (const auto &id : duplicates) {
+        if (id != merged.id) rows.push_back({id});
+    }
+    if (!rows.empty()) {
+        if (!stageText(conn, "merge_ids", {"id"}, rows)) return false;
+        const std::string keep = escapeSQL(merged.id);
+        beginTransaction();
+        const std::string steps[] = {
+            "INSERT OR IGNORE INTO item_collections (item_id, collection) "
+            "SELECT '" + keep + "', collection FROM item_collections WHERE item_id IN (SELECT id FROM merge_ids);",
+            "DELETE FROM item_collections WHERE item_id IN (SELECT id FROM merge_ids);",
+            // Attachments go after the kept item's own, in duplicate order, each path once
+            "INSERT INTO attachments (item_id, ordinal, path, size, mtime, hash, present, checked, mime) "
+            "SELECT '" + keep + "', COALESCE((SELECT max(ordinal) FROM attachments WHERE item_id = '" + keep + "'), 0) "
+            "+ CAST(row_number() OVER (ORDER BY m.rowid, a.ordinal) AS INTEGER), a.path, a.size, a.mtime, a.hash, a.present, a.checked, a.mime "
+            "FROM attachments a JOIN merge_ids m ON a.item_id = m.id "
+            "WHERE NOT EXISTS (SELECT 1 FROM attachments k WHERE k.item_id = '" + keep + "' AND k.path = a.path) "
+            "QUALIFY row_number() OVER (PARTITION BY a.path ORDER BY m.rowid, a.ordinal) = 1;",
+            "DELETE FROM attachments WHERE item_id IN (SELECT id FROM merge_ids);",
+            "DELETE FROM items WHERE id IN (SELECT id FROM merge_ids);",
+        };
+        for (const auto &sql : steps) {
+            auto res = conn.Query(sql);
+            if (!res || res->HasError()) {
+                std::cerr << "DB merge error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+                rollbackTransaction();
+                conn.Query("DROP TABLE IF EXISTS merge_ids;");
+                return false;
+            }
+        }
+        commitTransaction();
+        conn.Query("DROP TABLE IF EXISTS merge_ids;");
+        refreshPdfPaths("SELECT '" + keep + "'");
+        for (const auto &row : rows) notifyChange(DbChange::ItemDeleted, row[0]);
+    }
+    updateItem(merged);
+    return true;
+}
+
+void Database::deleteItems(const std::vector<std::string> &ids) {
+    if (ids.empty()) return;
+    auto &conn = *pimpl->conn;
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(ids.size());
+    for (const auto &id : ids) rows.push_back({id});
+    if (!stageText(conn, "delete_ids", {"id"}, rows)) return;
+    beginTransaction();
+    conn.Query("DELETE FROM item_collections WHERE item_id IN (SELECT id FROM delete_ids);");
+    conn.Query("DELETE FROM attachments WHERE item_id IN (SELECT id FROM delete_ids);");
+    auto res = conn.Query("DELETE FROM items WHERE id IN (SELECT id FROM delete_ids);");
+    if (!res || res->HasError()) {
+        std::cerr << "DB bulk delete error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS delete_ids;");
+        return;
+    }
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS delete_ids;");
+    for (const auto &id : ids) notifyChange(DbChange::ItemDeleted, id);
+}
+
+void Database::linkBibFile(const LinkedBibFile &file) {
+    if (file.path.empty()) return;
+    auto res = pimpl->conn->Query("INSERT OR REPLACE INTO linked_bibs (path, collection) VALUES ('" + escapeSQL(file.path) + "', '"
+                                  + escapeSQL(file.collection) + "');");
+    if (!res || res->HasError()) std::cerr << "DB link error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+}
+
+void Database::unlinkBibFile(const std::string &path) {
+    const std::string p = escapeSQL(path);
+    pimpl->conn->Query("DELETE FROM linked_bib_entries WHERE path = '" + p + "';");
+    pimpl->conn->Query("DELETE FROM linked_bibs WHERE path = '" + p + "';");
+}
+
+std::vector<LinkedBibFile> Database::listLinkedBibFiles() {
+    std::vector<LinkedBibFile> out;
+    auto res = pimpl->conn->Query("SELECT path, collection FROM linked_bibs ORDER BY path");
+    if (!res || res->HasError()) return out;
+    for (size_t i = 0; i < res->RowCount(); ++i) {
+        out.push_back({valueToString(res->GetValue(0, i)), valueToString(res->GetValue(1, i))});
+    }
+    return out;
+}
+
+std::vector<LinkedBibEntry> Database::getLinkedBibEntries(const std::string &path) {
+    std::vector<LinkedBibEntry> out;
+    auto res = pimpl->conn->Query("SELECT entry_key, hash, item_id FROM linked_bib_entries WHERE path = '" + escapeSQL(path) + "'");
+    if (!res || res->HasError()) return out;
+    out.reserve(res->RowCount());
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            LinkedBibEntry e;
+            e.key = valueToString(chunk->GetValue(0, r));
+            auto h = chunk->GetValue(1, r);
+            if (!h.IsNull()) e.hash = h.GetValue<uint64_t>();
+            e.itemId = valueToString(chunk->GetValue(2, r));
+            out.push_back(std::move(e));
+        }
+    }
+    return out;
+}
+
+std::vector<std::string> Database::updateLinkedBibEntries(const std::string &path, const std::vector<LinkedBibEntry> &entries,
+                                                          const std::vector<std::string> &removedKeys) {
+    std::vector<std::string> orphans;
+    if (entries.empty() && removedKeys.empty()) return orphans;
+    auto &conn = *pimpl->conn;
+    auto res = conn.Query("CREATE OR REPLACE TEMP TABLE bib_entries (entry_key TEXT, hash UBIGINT, item_id TEXT);");
+    if (!res || res->HasError()) return orphans;
+    std::vector<std::vector<std::string>> removed;
+    removed.reserve(removedKeys.size());
+    for (const auto &k : removedKeys) removed.push_back({k});
+    try {
+        duckdb::Appender appender(conn, "bib_entries");
+        for (const auto &e : entries) appender.AppendRow(duckdb::Value(e.key), duckdb::Value::UBIGINT(e.hash), duckdb::Value(e.itemId));
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB linked entry staging error: " << e.what() << "\n";
+        return orphans;
+    }
+    if (!stageText(conn, "bib_removed", {"entry_key"}, removed)) return orphans;
+    const std::string p = escapeSQL(path);
+    // Items of the removed entries, collected before their rows go away
+    conn.Query("CREATE OR REPLACE TEMP TABLE bib_gone AS SELECT DISTINCT item_id FROM linked_bib_entries "
+               "WHERE path = '" + p + "' AND entry_key IN (SELECT entry_key FROM bib_removed);");
+    beginTransaction();
+    const std::string steps[] = {
+        "DELETE FROM linked_bib_entries WHERE path = '" + p + "' AND entry_key IN (SELECT entry_key FROM bib_removed);",
+        "INSERT OR REPLACE INTO linked_bib_entries (path, entry_key, hash, item_id) "
+        "SELECT '" + p + "', entry_key, hash, item_id FROM bib_entries;",
+    };
+    bool ok = true;
+    for (const auto &sql : steps) {
+        auto r = conn.Query(sql);
+        if (!r || r->HasError()) {
+            std::cerr << "DB linked entry error: " << (r ? r->GetError() : std::string("<no result>")) << "\n";
+            ok = false;
+            break;
+        }
+    }
+    if (ok) commitTransaction(); else rollbackTransaction();
+    if (ok) {
+        // Still referenced by another entry (a renamed key, or another linked file)?
+        auto gone = conn.Query("SELECT item_id FROM bib_gone g WHERE item_id <> '' "
+                               "AND NOT EXISTS (SELECT 1 FROM linked_bib_entries e WHERE e.item_id = g.item_id);");
+        if (gone && !gone->HasError()) {
+            for (size_t i = 0; i < gone->RowCount(); ++i) orphans.push_back(valueToString(gone->GetValue(0, i)));
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS bib_entries;");
+    conn.Query("DROP TABLE IF EXISTS bib_removed;");
+    conn.Query("DROP TABLE IF EXISTS bib_gone;");
+    return orphans;
+}
+
+void Database::addLiveExport(const LiveExport &e) {
+    if (e.path.empty()) return;
+    const std::string p = escapeSQL(e.path);
+    pimpl->conn->Query("DELETE FROM live_export_entries WHERE path = '" + p + "';");
+    auto res = pimpl->conn->Query("INSERT OR REPLACE INTO live_exports (path, collection, key_pref, size, hash) VALUES ('" + p + "', '"
+                                  + escapeSQL(e.collection) + "', " + std::to_string(e.keyPref) + ", -1, NULL);");
+    if (!res || res->HasError()) std::cerr << "DB live export error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+}
+
+void Database::removeLiveExport(const std::string &path) {
+    const std::string p = escapeSQL(path);
+    pimpl->conn->Query("DELETE FROM live_export_entries WHERE path = '" + p + "';");
+    pimpl->conn->Query("DELETE FROM live_exports WHERE path = '" + p + "';");
+}
+
+std::vector<LiveExport> Database::listLiveExports() {
+    std::vector<LiveExport> out;
+    auto res = pimpl->conn->Query("SELECT path, collection, key_pref, size, hash FROM live_exports ORDER BY path");
+    if (!res || res->HasError()) return out;
+    for (size_t i = 0; i < res->RowCount(); ++i) {
+        LiveExport e;
+        e.path = valueToString(res->GetValue(0, i));
+        e.collection = valueToString(res->GetValue(1, i));
+        auto pref = res->GetValue(2, i);
+        if (!pref.IsNull()) e.keyPref = pref.GetValue<int32_t>();
+        auto size = res->GetValue(3, i);
+        if (!size.IsNull()) e.size = size.GetValue<int64_t>();
+        auto hash = res->GetValue(4, i);
+        if (!hash.IsNull()) e.hash = hash.GetValue<uint64_t>();
+        out.push_back(std::move(e));
+    }
+    return out;
+}
+
+std::vector<LiveExportEntry> Database::getLiveExportEntries(const std::string &path) {
+    std::vector<LiveExportEntry> out;
+    auto res = pimpl->conn->Query("SELECT item_id, version, entry_offset, entry_length FROM live_export_entries WHERE path = '"
+                                  + escapeSQL(path) + "'");
+    if (!res || res->HasError()) return out;
+    out.reserve(res->RowCount());
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            LiveExportEntry e;
+            e.itemId = valueToString(chunk->GetValue(0, r));
+            e.version = valueToString(chunk->GetValue(1, r));
+            e.offset = chunk->GetValue(2, r).GetValue<int64_t>();
+            e.length = chunk->GetValue(3, r).GetValue<int64_t>();
+            out.push_back(std::move(e));
+        }
+    }
+    return out;
+}
+
+void Database::setLiveExportEntries(const std::string &path, const std::vector<LiveExportEntry> &entries, int64_t size, uint64_t hash) {
+    auto &conn = *pimpl->conn;
+    auto res = conn.Query("CREATE OR REPLACE TEMP TABLE export_entries (item_id TEXT, version TEXT, entry_offset BIGINT, entry_length BIGINT);");
+    if (!res || res->HasError()) return;
+    try {
+        duckdb::Appender appender(conn, "export_entries");
+        for (const auto &e : entries) {
+            appender.AppendRow(duckdb::Value(e.itemId), duckdb::Value(e.version), duckdb::Value::BIGINT(e.offset), duckdb::Value::BIGINT(e.length));
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB export index staging error: " << e.what() << "\n";
+        return;
+    }
+    const std::string p = escapeSQL(path);
+    beginTransaction();
+    const std::string steps[] = {
+        "DELETE FROM live_export_entries WHERE path = '" + p + "';",
+        "INSERT INTO live_export_entries SELECT '" + p + "', item_id, version, entry_offset, entry_length FROM export_entries;",
+        "UPDATE live_exports SET size = " + std::to_string(size) + ", hash = " + std::to_string(hash) + " WHERE path = '" + p + "';",
+    };
+    bool ok = true;
+    for (const auto &sql : steps) {
+        auto r = conn.Query(sql);
+        if (!r || r->HasError()) {
+            std::cerr << "DB export index error: " << (r ? r->GetError() : std::string("<no result>")) << "\n";
+            ok = false;
+            break;
+        }
+    }
+    if (ok) commitTransaction(); else rollbackTransaction();
+    conn.Query("DROP TABLE IF EXISTS export_entries;");
+}
+
+std::vector<std::pair<std::string, std::string>> Database::listItemVersions(const std::string &collection) {
+    std::vector<std::pair<std::string, std::string>> out;
+    std::string sql = "SELECT i.id, COALESCE(CAST(i.modified AS VARCHAR), '') || '|' || COALESCE(i.citekey, '') FROM items i";
+    if (!collection.empty()) {
+        sql += " WHERE i.id IN (SELECT item_id FROM item_collections WHERE collection = '" + escapeSQL(collection)
+             + "' OR collection LIKE '" + escapeSQL(escapeLike(collection)) + "/%' ESCAPE '\\')";
+    }
+    sql += " ORDER BY COALESCE(i.title, ''), i.id";
+    auto res = pimpl->conn->Query(sql);
+    if (!res || res->HasError()) return out;
+    out.reserve(res->RowCount());
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            out.emplace_back(valueToString(chunk->GetValue(0, r)), valueToString(chunk->GetValue(1, r)));
+        }
+    }
+    return out;
+}
+
+void Database::refreshPdfPaths(const std::string &idQuery) {
+    auto res = pimpl->conn->Query("UPDATE items SET pdf_path = COALESCE((SELECT string_agg(a.path, ';' ORDER BY a.ordinal) "
+                                  "FROM attachments a WHERE a.item_id = items.id), '') WHERE id IN (" + idQuery + ");");
+    if (!res || res->HasError()) std::cerr << "DB attachment error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+}
+
+void Database::migrateAttachments() {
+    auto &conn = *pimpl->conn;
+    // Status rows without an ordinal were derived from pdf_path before it moved here
+    conn.Query("DELETE FROM attachments WHERE ordinal IS NULL;");
+    auto res = conn.Query("INSERT INTO attachments (item_id, ordinal, path) "
+                          + splitPdfPaths("(SELECT id, pdf_path FROM items WHERE id NOT IN (SELECT item_id FROM attachments)) i") + ";");
+    if (!res || res->HasError()) {
+        std::cerr << "DB attachment migration error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        return;
+    }
+    if (affectedRows(*res) > 0) refreshPdfPaths("SELECT DISTINCT item_id FROM attachments");
+}
+
+// Stage (item id, path) pairs, skipping blank paths, for addAttachments/removeAttachments
+static bool stageAttachmentPairs(duckdb::Connection &conn, const std::string &table,
+                                 const std::vector<std::pair<std::string, std::string>> &attachments) {
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(attachments.size());
+    for (const auto &a : attachments) {
+        if (!a.first.empty() && !a.second.empty()) rows.push_back({a.first, a.second});
+    }
+    if (rows.empty()) return false;
+    return stageText(conn, table, {"item_id", "path"}, rows);
+}
+
+void Database::addAttachments(const std::vector<std::pair<std::string, std::string>> &attachments) {
+    auto &conn = *pimpl->conn;
+    if (!stageAttachmentPairs(conn, "attachments_add", attachments)) return;
+    beginTransaction();
+    // New paths in the order given, each once per item, numbered after the item's last attachment
+    auto res = conn.Query("INSERT INTO attachments (item_id, ordinal, path) "
+                          "SELECT n.item_id, COALESCE((SELECT max(ordinal) FROM attachments a WHERE a.item_id = n.item_id), 0) "
+                          "+ CAST(row_number() OVER (PARTITION BY n.item_id ORDER BY n.first) AS INTEGER), n.path "
+                          "FROM (SELECT item_id, path, min(rowid) AS first FROM attachments_add GROUP BY item_id, path) n "
+                          "WHERE n.item_id IN (SELECT id FROM items) "
+                          "AND NOT EXISTS (SELECT 1 FROM attachments a WHERE a.item_id = n.item_id AND a.path = n.path);");
+    if (!res || res->HasError()) {
+        std::cerr << "DB attachment error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS attachments_add;");
+        return;
+    }
+    refreshPdfPaths("SELECT DISTINCT item_id FROM attachments_add");
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS attachments_add;");
+    std::unordered_set<std::string> notified;
+    for (const auto &a : attachments) {
+        if (notified.insert(a.first).second) notifyChange(DbChange::ItemUpdated, a.first);
+    }
+}
+
+void Database::removeAttachments(const std::vector<std::pair<std::string, std::string>> &attachments) {
+    auto &conn = *pimpl->conn;
+    if (!stageAttachmentPairs(conn, "attachments_remove", attachments)) return;
+    beginTransaction();
+    auto res = conn.Query("DELETE FROM attachments WHERE EXISTS (SELECT 1 FROM attachments_remove r "
+                          "WHERE r.item_id = attachments.item_id AND r.path = attachments.path);");
+    if (!res || res->HasError()) {
+        std::cerr << "DB attachment error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        rollbackTransaction();
+        conn.Query("DROP TABLE IF EXISTS attachments_remove;");
+        return;
+    }
+    refreshPdfPaths("SELECT DISTINCT item_id FROM attachments_remove");
+    commitTransaction();
+    conn.Query("DROP TABLE IF EXISTS attachments_remove;");
+    std::unordered_set<std::string> notified;
+    for (const auto &a : attachments) {
+        if (notified.insert(a.first).second) notifyChange(DbChange::ItemUpdated, a.first);
+    }
+}
+
+// Fill an Attachment from columns size, mtime, hash, present, scanned, mime starting at `col`
+static void attachmentFromChunk(duckdb::DataChunk &chunk, duckdb::idx_t row, duckdb::idx_t col, Attachment &out) {
+    auto size = chunk.GetValue(col, row);
+    if (!size.IsNull()) out.size = size.GetValue<int64_t>();
+    auto mtime = chunk.GetValue(col + 1, row);
+    if (!mtime.IsNull()) out.mtime = mtime.GetValue<int64_t>();
+    auto hash = chunk.GetValue(col + 2, row);
+    if (!hash.IsNull()) out.hash = hash.GetValue<uint64_t>();
+    auto present = chunk.GetValue(col + 3, row);
+    out.present = !present.IsNull() && present.GetValue<bool>();
+    out.scanned = chunk.GetValue(col + 4, row).GetValue<bool>();
+    out.mime = valueToString(chunk.GetValue(col + 5, row));
+}
+
+std::vector<Attachment> Database::getAttachments(const std::vector<std::string> &itemIds) {
+    std::vector<Attachment> out;
+    if (itemIds.empty()) return out;
+    auto &conn = *pimpl->conn;
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(itemIds.size());
+    for (const auto &id : itemIds) rows.push_back({id});
+    if (!stageText(conn, "status_ids", {"id"}, rows)) return out;
+    auto res = conn.Query("SELECT item_id, ordinal, path, size, mtime, hash, present, checked IS NOT NULL, mime FROM attachments "
+                          "WHERE item_id IN (SELECT id FROM status_ids) ORDER BY item_id, ordinal");
+    if (res && !res->HasError()) {
+        while (auto chunk = res->Fetch()) {
+            if (chunk->size() == 0) break;
+            for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+                Attachment a;
+                a.itemId = valueToString(chunk->GetValue(0, r));
+                a.ordinal = chunk->GetValue(1, r).GetValue<int32_t>();
+                a.path = valueToString(chunk->GetValue(2, r));
+                attachmentFromChunk(*chunk, r, 3, a);
+                out.push_back(std::move(a));
+            }
+        }
+    }
+    conn.Query("DROP TABLE IF EXISTS status_ids;");
+    return out;
+}
+
+std::vector<Attachment> Database::listAttachmentsToScan(size_t limit, int64_t recheckSeconds) {
+    std::vector<Attachment> out;
+    auto res = pimpl->conn->Query("SELECT path, max(size), max(mtime), max(hash), bool_or(present), min(checked) IS NOT NULL, max(mime) "
+                                  "FROM attachments WHERE checked IS NULL OR checked < CAST(current_timestamp AS TIMESTAMP) - to_seconds("
+                                  + std::to_string(recheckSeconds) + ") GROUP BY path ORDER BY min(checked) NULLS FIRST, path LIMIT "
+                                  + std::to_string(limit));
+    if (!res || res->HasError()) return out;
+    while (auto chunk = res->Fetch()) {
+        if (chunk->size() == 0) break;
+        for (duckdb::idx_t r = 0; r < chunk->size(); ++r) {
+            Attachment a;
+            a.path = valueToString(chunk->GetValue(0, r));
+            attachmentFromChunk(*chunk, r, 1, a);
+            out.push_back(std::move(a));
+        }
+    }
+    return out;
+}
+
+void Database::setAttachmentStatus(const std::vector<Attachment> &statuses) {
+    if (statuses.empty()) return;
+    auto &conn = *pimpl->conn;
+    auto res = conn.Query("CREATE OR REPLACE TEMP TABLE scanned_files (path TEXT, size BIGINT, mtime BIGINT, hash UBIGINT, present BOOLEAN, mime TEXT);");
+    if (!res || res->HasError()) return;
+    try {
+        duckdb::Appender appender(conn, "scanned_files");
+        for (const auto &a : statuses) {
+            appender.AppendRow(duckdb::Value(a.path), duckdb::Value::BIGINT(a.size), duckdb::Value::BIGINT(a.mtime),
+                               duckdb::Value::UBIGINT(a.hash), duckdb::Value::BOOLEAN(a.present), duckdb::Value(a.mime));
+        }
+        appender.Close();
+    } catch (std::exception &e) {
+        std::cerr << "DB attachment status staging error: " << e.what() << "\n";
+        return;
+    }
+    auto r = conn.Query("UPDATE attachments SET size = s.size, mtime = s.mtime, hash = s.hash, present = s.present, mime = s.mime, "
+                        "checked = current_timestamp FROM scanned_files s WHERE attachments.path = s.path;");
+    if (!r || r->HasError()) std::cerr << "DB attachment status error: " << (r ? r->GetError() : std::string("<no result>")) << "\n";
+    conn.Query("DROP TABLE IF EXISTS scanned_files;");
+}
+
+void Database::invalidateAttachmentDir(const std::string &dir) {
+    if (dir.empty()) return;
+    const std::string d = escapeSQL(dir);
+    pimpl->conn->Query("UPDATE attachments SET checked = NULL WHERE starts_with(path, '" + d + "/') OR starts_with(path, '" + d + "\\');");
+}
+
+std::vector<std::string> Database::listAttachmentDirs(size_t limit) {
+    std::vector<std::string> out;
+    auto res = pimpl->conn->Query("SELECT regexp_replace(path, '[/\\\\][^/\\\\]*$', '') AS dir, count(*) AS n FROM attachments "
+                                  "GROUP BY dir ORDER BY n DESC, dir LIMIT " + std::to_string(limit));
+    if (!res || res->HasError()) return out;
+    for (size_t i = 0; i < res->RowCount(); ++i) {
+        std::string dir = valueToString(res->GetValue(0, i));
+        if (!dir.empty()) out.push_back(std::move(dir));
+    }
+    return out;
+}
+
+std::vector<std::string> Database::listAttachmentPaths() {
+    std::vector<std::string> out;
+    auto res = pimpl->conn->Query("SELECT DISTINCT path FROM attachments");
+    if (!res || res->HasError()) return out;
+    out.reserve(res->RowCount());
+    for (size_t i = 0; i < res->RowCount(); ++i) out.push_back(valueToString(res->GetValue(0, i)));
+    return out;
+}
+
+uint64_t Database::revision() const { return pimpl->revision; }
+
+uint64_t Database::collectionsRevision() const { return pimpl->collectionsRevision; }
+
+void Database::addChangeListener(std::function<void(const DbChange&)> listener) {
+    if (listener) pimpl->listeners.push_back(std::move(listener));
+}
+
+void Database::beginTransaction() {
+    if (pimpl->txDepth++ > 0) return;
+    pimpl->txFailed = false;
+    pimpl->conn->Query("BEGIN TRANSACTION");
+}
+
+bool Database::commitTransaction() {
+    if (pimpl->txDepth == 0) return false;
+    if (--pimpl->txDepth > 0) return !pimpl->txFailed;
+    std::vector<DbChange> changes;
+    changes.swap(pimpl->pendingChanges);
+    if (pimpl->txFailed) {
+        pimpl->conn->Query("ROLLBACK");
+        return false;
+    }
+    auto res = pimpl->conn->Query("COMMIT");
+    if (!res || res->HasError()) {
+        std::cerr << "DB commit error: " << (res ? res->GetError() : std::string("<no result>")) << "\n";
+        pimpl->conn->Query("ROLLBACK");
+        return false;
+    }
+    for (const auto &c : changes) notifyChange(c.kind, c.id, c.detail);
+    return true;
+}
+
+void Database::rollbackTransaction() {
+    if (pimpl->txDepth == 0) return;
+    pimpl->txFailed = true;
+    if (--pimpl->txDepth > 0) return;
+    pimpl->pendingChanges.clear();
+    pimpl->conn->Query("ROLLBACK");
+}
+
+void Database::notifyChange(DbChange::Kind kind, const std::string &id, const std::string &detail) {
+    if (pimpl->txDepth > 0) {
+        pimpl->pendingChanges.push_back({kind, id, detail});
+        return;
+    }
+    ++pimpl->revision;
+    if (kind == DbChange::CollectionAdded || kind == DbChange::CollectionRenamed || kind == DbChange::CollectionDeleted) {
+        ++pimpl->collectionsRevision;
+    }
+    if (pimpl->listeners.empty()) return;
+    DbChange change{kind, id, detail};
+    for (const auto &l : pimpl->listeners) l(change);
+}
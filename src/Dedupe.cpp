@@ -0,0 +1,192 @@
+#include "Dedupe.h"
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+bool isAsciiAlnum(unsigned char c) { return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'); }
+unsigned char asciiLower(unsigned char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; }
+
+// Letters and digits (lowercased) plus non-ASCII bytes, runs of anything else
+// collapsed to one space, no leading or trailing space
+std::string normalizeWords(const std::string &s) {
+    std::string out;
+    out.reserve(s.size());
+    for (unsigned char c : s) {
+        c = asciiLower(c);
+        if (isAsciiAlnum(c) || c >= 0x80) out += char(c);
+        else if (!out.empty() && out.back() != ' ') out += ' ';
+    }
+    if (!out.empty() && out.back() == ' ') out.pop_back();
+    return out;
+}
+
+uint64_t fnv1a(const char *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// One fixed seed per MinHash permutation, so signatures are stable across runs
+const std::array<uint64_t, kMinHashSize> &minHashSeeds() {
+    static const std::array<uint64_t, kMinHashSize> seeds = [] {
+        std::array<uint64_t, kMinHashSize> s{};
+        uint64_t x = 0x6a09e667f3bcc908ULL;
+        for (auto &v : s) v = mix(x += 0x9e3779b97f4a7c15ULL);
+        return s;
+    }();
+    return seeds;
+}
+
+std::vector<std::string> splitAuthors(const std::string &authors) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t i = 0; i <= authors.size(); ++i) {
+        size_t sepLen = 0;
+        if (i == authors.size() || authors[i] == ';') sepLen = 1;
+        else if (i + 5 <= authors.size() && authors[i] == ' ' && authors[i + 4] == ' '
+                 && asciiLower(authors[i + 1]) == 'a' && asciiLower(authors[i + 2]) == 'n' && asciiLower(authors[i + 3]) == 'd') sepLen = 5;
+        if (!sepLen) continue;
+        parts.push_back(authors.substr(start, i - start));
+        start = i + sepLen;
+        i += sepLen - 1;
+    }
+    return parts;
+}
+
+} // namespace
+
+std::string normalizeTitle(const std::string &title) { return normalizeWords(title); }
+
+std::vector<std::string> authorLastNames(const std::string &authors) {
+    std::vector<std::string> names;
+    for (const auto &part : splitAuthors(authors)) {
+        std::string name;
+        size_t comma = part.find(',');
+        if (comma != std::string::npos) {
+            name = normalizeWords(part.substr(0, comma));
+        } else {
+            std::string words = normalizeWords(part);
+            size_t sp = words.rfind(' ');
+            name = sp == std::string::npos ? words : words.substr(sp + 1);
+            // "Smith J" / "Smith JA": trailing initials, the surname comes first
+            if (sp != std::string::npos && name.size() <= 2) name = words.substr(0, words.find(' '));
+        }
+        if (!name.empty()) names.push_back(name);
+    }
+    return names;
+}
+
+std::vector<uint64_t> dedupeTokens(const Item &it) {
+    std::vector<uint64_t> tokens;
+    const std::string title = normalizeTitle(it.title);
+    const uint64_t titleSeed = fnv1a("t", 1);
+    if (title.size() < 3) {
+        if (!title.empty()) tokens.push_back(fnv1a(title.data(), title.size(), titleSeed));
+    } else {
+        tokens.reserve(title.size());
+        for (size_t i = 0; i + 3 <= title.size(); ++i) tokens.push_back(fnv1a(title.data() + i, 3, titleSeed));
+    }
+    const uint64_t authorSeed = fnv1a("a", 1);
+    for (const auto &name : authorLastNames(it.authors)) tokens.push_back(fnv1a(name.data(), name.size(), authorSeed));
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    return tokens;
+}
+
+MinHashSignature minHashSignature(const std::vector<uint64_t> &tokens) {
+    MinHashSignature sig;
+    sig.fill(UINT64_MAX);
+    const auto &seeds = minHashSeeds();
+    for (uint64_t t : tokens) {
+        for (int i = 0; i < kMinHashSize; ++i) {
+            uint64_t h = mix(t ^ seeds[i]);
+            if (h < sig[i]) sig[i] = h;
+        }
+    }
+    return sig;
+}
+
+std::array<int64_t, kMinHashBands> lshBuckets(const MinHashSignature &sig) {
+    std::array<int64_t, kMinHashBands> buckets;
+    for (int b = 0; b < kMinHashBands; ++b) {
+        buckets[b] = (int64_t)fnv1a(reinterpret_cast<const char*>(&sig[b * kMinHashRows]), sizeof(uint64_t) * kMinHashRows);
+    }
+    return buckets;
+}
+
+double tokenJaccard(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) {
+    if (a.empty() && b.empty()) return 0.0;
+    size_t i = 0, j = 0, common = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) ++i;
+        else if (b[j] < a[i]) ++j;
+        else { ++common; ++i; ++j; }
+    }
+    return double(common) / double(a.size() + b.size() - common);
+}
+
+bool mergeItemFields(Item &keep, const Item &dup) {
+    bool changed = false;
+    static std::string Item::*const fields[] = {
+        &Item::title, &Item::authors, &Item::year, &Item::type, &Item::doi, &Item::isbn, &Item::abstract,
+        &Item::address, &Item::publisher, &Item::url, &Item::journal, &Item::pages, &Item::volume,
+        &Item::number, &Item::editor, &Item::booktitle, &Item::series, &Item::edition, &Item::chapter,
+        &Item::school, &Item::institution, &Item::organization, &Item::howpublished, &Item::language,
+        &Item::keywords, &Item::month, &Item::note,
+    };
+    for (auto f : fields) {
+        std::string &dest = keep.*f;
+        if (dest.empty() && !(dup.*f).empty()) { dest = dup.*f; changed = true; }
+    }
+    if (keep.collection.empty() && !dup.collection.empty()) { keep.collection = dup.collection; changed = true; }
+
+    // Extra fields: keys missing or blank in the kept item
+    if (!dup.extra.empty()) {
+        QJsonObject kept = QJsonDocument::fromJson(QByteArray::fromStdString(keep.extra)).object();
+        const QJsonObject other = QJsonDocument::fromJson(QByteArray::fromStdString(dup.extra)).object();
+        bool added = false;
+        for (const QString &k : other.keys()) {
+            if (kept.contains(k) && !kept.value(k).toString().trimmed().isEmpty()) continue;
+            if (kept.value(k) == other.value(k)) continue;
+            kept.insert(k, other.value(k));
+            added = true;
+        }
+        if (added) {
+            keep.extra = QJsonDocument(kept).toJson(QJsonDocument::Compact).toStdString();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool mergeDuplicates(Database &db, const std::string &keepId, const std::vector<std::string> &duplicateIds) {
+    std::vector<std::string> ids{keepId};
+    for (const auto &id : duplicateIds) {
+        if (id != keepId) ids.push_back(id);
+    }
+    std::unordered_map<std::string, Item> byId;
+    for (auto &it : db.getItems(ids)) byId.emplace(it.id, std::move(it));
+    auto keep = byId.find(keepId);
+    if (keep == byId.end()) return false;
+    Item merged = keep->second;
+    std::vector<std::string> removed;
+    for (size_t i = 1; i < ids.size(); ++i) {
+        auto dup = byId.find(ids[i]);
+        if (dup == byId.end()) continue;
+        mergeItemFields(merged, dup->second);
+        removed.push_back(ids[i]);
+    }
+    return db.mergeItems(merged, removed);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Database.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Near-duplicate detection: items are reduced to a set of hashed tokens
+// (character trigrams of the normalized title plus author last names), summarized
+// by a MinHash signature and bucketed with LSH banding. Items sharing a bucket in
+// any band are candidates; candidates are confirmed with the exact Jaccard
+// similarity of their token sets. Database::findDuplicateClusters drives this
+// over the whole library.
+
+constexpr int kMinHashBands = 16;
+constexpr int kMinHashRows = 4;
+constexpr int kMinHashSize = kMinHashBands * kMinHashRows;
+
+using MinHashSignature = std::array<uint64_t, kMinHashSize>;
+
+// Lowercased ASCII letters and digits, every other ASCII character a single space,
+// non-ASCII bytes kept as they are: "The  B-Tree, revisited." -> "the b tree revisited"
+std::string normalizeTitle(const std::string &title);
+
+// Normalized last names of "Last, First", "First Last" and "Last F" authors
+// separated by ';' or " and ": "Smith, J. and Jane Doe" -> {"smith", "doe"}
+std::vector<std::string> authorLastNames(const std::string &authors);
+
+// Sorted, unique token hashes of an item; empty when it has no title and no authors
+std::vector<uint64_t> dedupeTokens(const Item &it);
+
+MinHashSignature minHashSignature(const std::vector<uint64_t> &tokens);
+
+// One bucket id per band
+std::array<int64_t, kMinHashBands> lshBuckets(const MinHashSignature &sig);
+
+// |a ∩ b| / |a ∪ b| of two sorted token lists
+double tokenJaccard(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b);
+
+// Fill blank fields of `keep` from `dup` and merge extra JSON; never overwrites a value
+// `keep` already has. Attachments are left alone (see Database::addAttachments).
+// Returns true if `keep` changed.
+bool mergeItemFields(Item &keep, const Item &dup);
+
+// Merge `duplicateIds` into `keepId` (fields, attachments, collections) and delete
+// them. Returns false if `keepId` does not exist.
+bool mergeDuplicates(Database &db, const std::string &keepId, const std::vector<std::string> &duplicateIds);
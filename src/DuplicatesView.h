@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <unordered_map>
+#include "Dedupe.h"
+
+// Forward declaration to avoid circular dependency
+class MainWindow;
+
+// Lists near-duplicate clusters (Database::findDuplicateClusters), one top-level row
+// per cluster with its items below, oldest first. A cluster is merged into the
+// selected item, or into its oldest item when the cluster row itself is selected.
+inline void MainWindow::findDuplicates() {
+    flushPendingEdits();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<DuplicateCluster> clusters = db->findDuplicateClusters();
+    std::vector<std::string> ids;
+    for (const auto &c : clusters) ids.insert(ids.end(), c.ids.begin(), c.ids.end());
+    std::unordered_map<std::string, Item> items;
+    for (auto &it : db->getItems(ids)) items.emplace(it.id, std::move(it));
+    QApplication::restoreOverrideCursor();
+
+    if (clusters.empty()) {
+        QMessageBox::information(this, "Find Duplicates", "No duplicates found.");
+        return;
+    }
+
+    QDialog dlg(this);
+    dlg.setWindowTitle("Find Duplicates");
+    auto *v = new QVBoxLayout(&dlg);
+    auto *summary = new QLabel(QString("%1 groups of possible duplicates").arg(clusters.size()));
+    v->addWidget(summary);
+    auto *tree = new QTreeWidget();
+    tree->setColumnCount(3);
+    tree->setHeaderLabels({"Title", "Authors", "Year"});
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    for (const auto &c : clusters) {
+        auto *group = new QTreeWidgetItem(tree);
+        group->setText(0, QString("%1 items, %2% similar").arg(c.ids.size()).arg(qRound(c.similarity * 100)));
+        for (const auto &id : c.ids) {
+            auto f = items.find(id);
+            if (f == items.end()) continue;
+            auto *row = new QTreeWidgetItem(group);
+            row->setText(0, QString::fromStdString(f->second.title));
+            row->setText(1, QString::fromStdString(f->second.authors));
+            row->setText(2, QString::fromStdString(f->second.year));
+            row->setData(0, Qt::UserRole, QString::fromStdString(id));
+        }
+        group->setExpanded(true);
+    }
+    v->addWidget(tree, 1);
+
+    auto *bbs = new QDialogButtonBox(QDialogButtonBox::Close);
+    auto *mergeBtn = bbs->addButton("Merge Group", QDialogButtonBox::ActionRole);
+    auto *mergeAllBtn = bbs->addButton("Merge All", QDialogButtonBox::ActionRole);
+    v->addWidget(bbs);
+    connect(bbs, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+
+    // Merge one group into `keep` (a child row), then drop the group from the view
+    auto mergeGroup = [this, tree, summary](QTreeWidgetItem *group, QTreeWidgetItem *keep) {
+        std::vector<std::string> others;
+        for (int i = 0; i < group->childCount(); ++i) {
+            if (group->child(i) != keep) others.push_back(group->child(i)->data(0, Qt::UserRole).toString().toStdString());
+        }
+        if (!mergeDuplicates(*db, keep->data(0, Qt::UserRole).toString().toStdString(), others)) return false;
+        delete group;
+        summary->setText(QString("%1 groups of possible duplicates").arg(tree->topLevelItemCount()));
+        return true;
+    };
+    connect(mergeBtn, &QPushButton::clicked, &dlg, [tree, mergeGroup]() {
+        QTreeWidgetItem *sel = tree->currentItem();
+        if (!sel) return;
+        QTreeWidgetItem *group = sel->parent() ? sel->parent() : sel;
+        QTreeWidgetItem *keep = sel->parent() ? sel : group->child(0);
+        if (keep) mergeGroup(group, keep);
+    });
+    connect(mergeAllBtn, &QPushButton::clicked, &dlg, [this, tree, mergeGroup]() {
+        if (QMessageBox::question(this, "Merge All", QString("Merge all %1 groups, each into its oldest item?")
+                                  .arg(tree->topLevelItemCount())) != QMessageBox::Yes) return;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        while (tree->topLevelItemCount() > 0) {
+            QTreeWidgetItem *group = tree->topLevelItem(0);
+            if (group->childCount() == 0 || !mergeGroup(group, group->child(0))) delete group;
+        }
+        QApplication::restoreOverrideCursor();
+    });
+
+    dlg.resize(900, 600);
+    dlg.exec();
+    reload();
+}
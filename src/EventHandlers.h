@@ -2,6 +2,8 @@
 
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QRegularExpression>
+#include <QSignalBlocker>
 
 inline bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
     if (event->type() == QEvent::KeyPress) {
@@ -161,17 +163,12 @@ inline bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
             if (selectedItems.isEmpty()) return true;
 
             std::string itemId = selectedItems.first()->data(Qt::UserRole).toString().toStdString();
-            Item dbItem;
-            if (!db->getItem(itemId, dbItem)) return true;
-
-            QStringList existing = QString::fromStdString(dbItem.pdf_path).split(';', Qt::SkipEmptyParts);
+            // Paths the item has already are skipped by addAttachments
+            std::vector<std::pair<std::string, std::string>> added;
             for (const QUrl &u : urls) {
-                if (!u.isLocalFile()) continue;
-                QString path = u.toLocalFile();
-                if (!existing.contains(path)) existing << path;
+                if (u.isLocalFile()) added.emplace_back(itemId, u.toLocalFile().toStdString());
             }
-            dbItem.pdf_path = existing.join(';').toStdString();
-            db->updateItem(dbItem);
+            db->addAttachments(added);
 
             onItemSelected();
             de->acceptProposedAction();
@@ -183,61 +180,98 @@ inline bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
 }
 
 inline void MainWindow::reload() {
-    QStringList expanded = collectExpandedPaths();
     QString selectedPath;
     if (auto *sel = ui->collectionsList->currentItem()) selectedPath = sel->data(0, Qt::UserRole).toString();
+    rebuildCollectionTree(collectExpandedPaths(), selectedPath);
+}
 
+// Rebuild the collection tree, and the check list if the collections changed, from the
+// database, then restore the given expanded paths and selection. Only the top level is
+// created here: deeper levels are loaded by populateCollectionChildren when a node is
+// expanded. ui->collectionNodes indexes the nodes created so far by path.
+inline void MainWindow::rebuildCollectionTree(const QStringList &expanded, const QString &selectedPath) {
     ui->collectionsList->clear();
     ui->itemsList->clear();
-    ui->collectionCheckList->clear();
-
-    auto collections = db->listCollections();
-
-    // Populate checkable collections list
-    for (const auto &collection : collections) {
-        QString path = QString::fromStdString(collection);
-        auto *checkItem = new QListWidgetItem(path);
-        checkItem->setFlags(checkItem->flags() | Qt::ItemIsUserCheckable);
-        checkItem->setCheckState(Qt::Unchecked);
-        checkItem->setData(Qt::UserRole, path);
-        ui->collectionCheckList->addItem(checkItem);
+    ui->collectionNodes.clear();
+
+    // Populate checkable collections list, unless the set of collections is unchanged
+    // (onItemSelected sets the check states)
+    if (ui->collectionCheckListRevision != db->collectionsRevision()) {
+        ui->collectionCheckList->clear();
+        for (const auto &collection : db->listCollections()) {
+            QString path = QString::fromStdString(collection);
+            auto *checkItem = new QListWidgetItem(path);
+            checkItem->setFlags(checkItem->flags() | Qt::ItemIsUserCheckable);
+            checkItem->setCheckState(Qt::Unchecked);
+            checkItem->setData(Qt::UserRole, path);
+            ui->collectionCheckList->addItem(checkItem);
+        }
+        ui->collectionCheckListRevision = db->collectionsRevision();
     }
 
-    auto *allItems = new QTreeWidgetItem(ui->collectionsList);
+    auto *allItems = new QTreeWidgetItem();
     allItems->setText(0, "All Items");
     allItems->setData(0, Qt::UserRole, "");
-
-    for (const auto &collection : collections) {
-        QString path = QString::fromStdString(collection);
-        QTreeWidgetItem *parent = allItems;
-        const auto parts = path.split('/', Qt::SkipEmptyParts);
-        QString accum;
-        for (int i = 0; i < parts.size(); ++i) {
-            accum = accum.isEmpty() ? parts[i] : accum + "/" + parts[i];
-            parent = ensureChild(parent, parts[i]);
-            parent->setData(0, Qt::UserRole, accum);
-        }
-    }
+    ui->collectionNodes.insert(QString(), allItems);
+    populateCollectionChildren(allItems);
+    ui->collectionsList->addTopLevelItem(allItems);
 
     restoreExpandedPaths(expanded);
     ui->collectionsList->expandItem(allItems);
 
-    QTreeWidgetItem *selectItem = allItems;
-    if (!selectedPath.isEmpty()) {
-        QTreeWidgetItem *parent = allItems;
-        const auto parts = selectedPath.split('/', Qt::SkipEmptyParts);
-        QString accum;
-        for (int i = 0; i < parts.size(); ++i) {
-            parent = ensureChild(parent, parts[i]);
-            accum = accum.isEmpty()? parts[i] : accum + "/" + parts[i];
-            parent->setData(0, Qt::UserRole, accum);
-        }
-        selectItem = parent;
-    }
-    ui->collectionsList->setCurrentItem(selectItem);
+    QTreeWidgetItem *selectItem = collectionNode(selectedPath);
+    ui->collectionsList->setCurrentItem(selectItem ? selectItem : allItems);
     onCollectionSelected();
 }
 
+// Create the child nodes of `node` the first time it is needed. Child lists are cached per
+// path until the set of collections changes, so re-expanding after a reload costs no query.
+inline void MainWindow::populateCollectionChildren(QTreeWidgetItem *node) {
+    if (!node || node->data(0, CollectionLoadedRole).toBool()) return;
+    node->setData(0, CollectionLoadedRole, true);
+
+    if (ui->collectionChildCacheRevision != db->collectionsRevision()) {
+        ui->collectionChildCache.clear();
+        ui->collectionChildCacheRevision = db->collectionsRevision();
+    }
+    const QString path = node->data(0, Qt::UserRole).toString();
+    auto cached = ui->collectionChildCache.find(path);
+    if (cached == ui->collectionChildCache.end()) {
+        cached = ui->collectionChildCache.insert(path, db->listChildCollections(path.toStdString()));
+    }
+
+    QList<QTreeWidgetItem*> children;
+    children.reserve(int(cached->size()));
+    for (const auto &c : *cached) {
+        const QString name = QString::fromStdString(c.name);
+        const QString childPath = path.isEmpty() ? name : path + "/" + name;
+        auto *n = new QTreeWidgetItem();
+        n->setText(0, name);
+        n->setData(0, Qt::UserRole, childPath);
+        if (c.hasChildren) n->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        else n->setData(0, CollectionLoadedRole, true);
+        ui->collectionNodes.insert(childPath, n);
+        children << n;
+    }
+    node->addChildren(children);
+    if (children.isEmpty()) node->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+}
+
+// Node for a collection path, loading its ancestors' children as needed; null if it does not exist
+inline QTreeWidgetItem *MainWindow::collectionNode(const QString &path) {
+    if (QTreeWidgetItem *n = ui->collectionNodes.value(path)) return n;
+    QTreeWidgetItem *cur = ui->collectionNodes.value(QString());
+    const QStringList parts = path.split('/', Qt::SkipEmptyParts);
+    QString accum;
+    for (const QString &seg : parts) {
+        populateCollectionChildren(cur);
+        accum = accum.isEmpty() ? seg : accum + "/" + seg;
+        cur = ui->collectionNodes.value(accum);
+        if (!cur) return nullptr;
+    }
+    return cur;
+}
+
 inline QStringList MainWindow::fieldsForType(const QString &type) {
     QString t = type.toLower();
     if (t == "article") return {"author","title","journal","year","volume","number","pages","month","note","key","doi"};
@@ -257,79 +291,31 @@ inline QStringList MainWindow::fieldsForType(const QString &type) {
 }
 
 inline void MainWindow::populateDynamicFields(const QString &type, const Item *item) {
-    // Remove existing dynamic fields and clear both active and blank layouts completely
     QFormLayout *blankLayout = ui->dynamicFieldsLayout;
     QFormLayout *activeLayout = ui->dynamicActiveLayout;
-    // delete editor widgets referenced in map and remove them from layouts
-    for (auto it = ui->dynamicFieldEdits.begin(); it != ui->dynamicFieldEdits.end(); ++it) {
-        QWidget *w = it.value();
-        if (!w) continue;
-        // If the widget is in the active/main form, remove its label first
-        if (activeLayout) {
-            QWidget *lab = activeLayout->labelForField(w);
-            if (lab) {
-                activeLayout->removeWidget(lab);
-                lab->deleteLater();
-            }
-            activeLayout->removeWidget(w);
-        }
-        // Also ensure it's removed from the blank dynamic layout if present
-        if (blankLayout) {
-            QWidget *bl = blankLayout->labelForField(w);
-            if (bl) {
-                blankLayout->removeWidget(bl);
-                bl->deleteLater();
-            }
-            blankLayout->removeWidget(w);
-        }
-        w->deleteLater();
-    }
-    ui->dynamicFieldEdits.clear();
-    // helper to clear a layout fully (avoid takeAt on empty layout)
-    auto clearLayout = [](QFormLayout *lay){
-        while (lay->count() > 0) {
-            QLayoutItem *child = lay->takeAt(0);
-            if (child->widget()) child->widget()->deleteLater();
-            delete child;
-        }
-    };
-    if (blankLayout) clearLayout(blankLayout);
-    // Do NOT clear the active/main form layout here: clearing the main form
-    // would delete static widgets like Title/Authors. We already removed and
-    // deleted dynamic widgets above; leave the main form intact.
-
     QStringList fields = fieldsForType(type);
-    QJsonObject extraObj;
-    if (item && !QString::fromStdString(item->extra).trimmed().isEmpty()) {
-        QJsonDocument d = QJsonDocument::fromJson(QByteArray::fromStdString(item->extra));
-        if (d.isObject()) extraObj = d.object();
-    }
 
-    // helper: get extra JSON value case-insensitively for field name
-    auto getExtraValue = [&](const QString &field) -> QString {
-        if (extraObj.isEmpty()) return QString();
-        QString lf = field.toLower();
-        for (const QString &k : extraObj.keys()) {
-            if (k.toLower() == lf && extraObj.value(k).isString()) return extraObj.value(k).toString();
-        }
-        return QString();
+    // Rows are pooled per field list: the label/editor widgets for an entry type are built
+    // once and refilled on every selection. Only rows that change between active and blank,
+    // or belong to a different type than last time, touch the layouts.
+    auto detach = [](UI::DynamicFieldRow &row) {
+        if (!row.layout) return;
+        QFormLayout::TakeRowResult taken = row.layout->takeRow(row.editor);
+        delete taken.labelItem;
+        delete taken.fieldItem;
+        row.label->hide();
+        row.editor->hide();
+        row.layout = nullptr;
     };
 
-    // helper: parse note-formatted pairs like "key = {value}; key2 = {value2}" into map (case-insensitive keys)
-    QMap<QString, QString> notePairs;
-    if (item && !QString::fromStdString(item->note).trimmed().isEmpty()) {
-        QString note = QString::fromStdString(item->note);
-        auto parts = note.split(';', Qt::SkipEmptyParts);
-        QRegularExpression rx("^\\s*([^=\\s]+)\\s*=\\s*\\{(.*)\\}\\s*$");
-        for (const QString &p : parts) {
-            QString part = p.trimmed();
-            QRegularExpressionMatch m = rx.match(part);
-            if (m.hasMatch()) {
-                QString k = m.captured(1).trimmed().toLower();
-                QString v = m.captured(2).trimmed();
-                notePairs.insert(k, v);
-            }
+    const QString poolKey = fields.join('|');
+    if (poolKey != ui->dynamicPoolKey) {
+        auto old = ui->dynamicFieldPools.find(ui->dynamicPoolKey);
+        if (old != ui->dynamicFieldPools.end()) {
+            for (auto &row : *old) detach(row);
         }
+        ui->dynamicPoolKey = poolKey;
+        ui->dynamicFieldEdits.clear();
     }
 
     auto isMultiline = [](const QString &n) {
@@ -337,12 +323,67 @@ inline void MainWindow::populateDynamicFields(const QString &type, const Item *i
         return (ln == "abstract" || ln == "note" || ln == "keywords" || ln == "annotation");
     };
 
-    // Render each field as a single labeled row (preserves ordering), prefilling from Item, extra JSON, or note-pairs
-    int insertedPos = 0;
-    for (const QString &f : fields) {
-        QString lname = f.toLower();
-        if (lname == "title" || lname == "author" || lname == "authors" || lname == "year" || lname == "isbn" || lname == "doi") continue;
+    QVector<UI::DynamicFieldRow> &pool = ui->dynamicFieldPools[poolKey];
+    if (pool.isEmpty()) {
+        for (const QString &f : fields) {
+            QString lname = f.toLower();
+            if (lname == "title" || lname == "author" || lname == "authors" || lname == "year" || lname == "isbn" || lname == "doi") continue;
+
+            UI::DynamicFieldRow row;
+            row.field = f;
+            if (isMultiline(f)) {
+                QTextEdit *te = new QTextEdit();
+                te->setPlaceholderText(f);
+                te->setMaximumHeight(120);
+                // Typing only marks the field; the write happens once editing pauses
+                connect(te, &QTextEdit::textChanged, [this, f]() { markFieldDirty(f); });
+                row.editor = te;
+            } else {
+                QLineEdit *le = new QLineEdit();
+                le->setPlaceholderText(f);
+                connect(le, &QLineEdit::textEdited, [this, f]() { markFieldDirty(f); });
+                connect(le, &QLineEdit::editingFinished, [this]() { flushPendingEdits(); });
+                row.editor = le;
+            }
 
+            // Build a human-friendly label (capitalize, replace underscores/dashes)
+            QString displayLabel = f;
+            displayLabel.replace('_', ' ');
+            displayLabel.replace('-', ' ');
+            if (!displayLabel.isEmpty()) displayLabel[0] = displayLabel[0].toUpper();
+            row.label = new QLabel(displayLabel);
+            pool.append(row);
+        }
+    }
+
+    // Case-insensitive view of the extra JSON strings
+    QHash<QString, QString> extraValues;
+    if (item && !item->extra.empty()) {
+        QJsonDocument d = QJsonDocument::fromJson(QByteArray::fromStdString(item->extra));
+        if (d.isObject()) {
+            const QJsonObject extraObj = d.object();
+            for (auto it = extraObj.begin(); it != extraObj.end(); ++it) {
+                if (it.value().isString()) extraValues.insert(it.key().toLower(), it.value().toString());
+            }
+        }
+    }
+
+    // helper: parse note-formatted pairs like "key = {value}; key2 = {value2}" into map (case-insensitive keys)
+    QHash<QString, QString> notePairs;
+    if (item && !item->note.empty()) {
+        static const QRegularExpression rx("^\\s*([^=\\s]+)\\s*=\\s*\\{(.*)\\}\\s*$");
+        const QStringList parts = QString::fromStdString(item->note).split(';', Qt::SkipEmptyParts);
+        for (const QString &p : parts) {
+            QRegularExpressionMatch m = rx.match(p.trimmed());
+            if (m.hasMatch()) notePairs.insert(m.captured(1).trimmed().toLower(), m.captured(2).trimmed());
+        }
+    }
+
+    // Refill each row, prefilling from Item, extra JSON, or note-pairs, and place it in the
+    // active form (non-empty) or the blank section, preserving field order in both.
+    int activePos = 0, blankPos = 0;
+    for (auto &row : pool) {
+        QString lname = row.field.toLower();
         QString value;
         if (item) {
             if (lname == "publisher") value = QString::fromStdString(item->publisher);
@@ -365,51 +406,31 @@ inline void MainWindow::populateDynamicFields(const QString &type, const Item *i
             else if (lname == "address") value = QString::fromStdString(item->address);
             else if (lname == "note") value = QString::fromStdString(item->note);
         }
-        // fallback to extra JSON (case-insensitive)
-        if (value.trimmed().isEmpty()) {
-            QString ev = getExtraValue(f);
-            if (!ev.isEmpty()) value = ev;
-        }
-        // fallback to note-parsed pairs
-        if (value.trimmed().isEmpty()) {
-            QString np = notePairs.value(lname, QString());
-            if (!np.isEmpty()) value = np;
-        }
-
-        QWidget *editor = nullptr;
-        if (isMultiline(f)) {
-            QTextEdit *te = new QTextEdit();
-            te->setPlaceholderText(f);
-            te->setMaximumHeight(120);
-            if (!value.isEmpty()) te->setPlainText(value);
-            // when editing a blank multiline field, save immediately so populateDynamicFields
-            // will move it into the active layout on the next render
-            connect(te, &QTextEdit::textChanged, [this]() { onSaveItem(); });
-            editor = te;
-        } else {
-            QLineEdit *le = new QLineEdit();
-            le->setPlaceholderText(f);
-            if (!value.isEmpty()) le->setText(value);
-            // Save on edit; populateDynamicFields will re-render and place non-empty fields
-            connect(le, &QLineEdit::editingFinished, [this]() { onSaveItem(); });
-            editor = le;
+        // fallback to extra JSON, then to note-parsed pairs
+        if (value.trimmed().isEmpty()) value = extraValues.value(lname, value);
+        if (value.trimmed().isEmpty()) value = notePairs.value(lname, value);
+
+        {
+            // Refilling must not look like an edit
+            QSignalBlocker blocker(row.editor);
+            if (auto te = qobject_cast<QTextEdit*>(row.editor)) {
+                if (te->toPlainText() != value) te->setPlainText(value);
+            } else if (auto le = qobject_cast<QLineEdit*>(row.editor)) {
+                if (le->text() != value) le->setText(value);
+            }
         }
 
-        // Build a human-friendly label (capitalize, replace underscores/dashes)
-        QString displayLabel = f;
-        displayLabel.replace('_', ' ');
-        displayLabel.replace('-', ' ');
-        if (!displayLabel.isEmpty()) displayLabel[0] = displayLabel[0].toUpper();
-
-        // Decide which layout to add to: active (non-empty) or blank (empty)
-        if (!value.trimmed().isEmpty() && ui->dynamicActiveLayout) {
+        QFormLayout *target = (!value.trimmed().isEmpty() && activeLayout) ? activeLayout : blankLayout;
+        if (row.layout != target) {
+            detach(row);
             // Insert at the stored dynamic insert index so active fields appear in the desired order
-            int idx = ui->dynamicInsertIndex + insertedPos;
-            ui->dynamicActiveLayout->insertRow(idx, displayLabel, editor);
-            insertedPos++;
-        } else {
-            ui->dynamicFieldsLayout->addRow(displayLabel, editor);
+            if (target == activeLayout) target->insertRow(ui->dynamicInsertIndex + activePos, row.label, row.editor);
+            else target->insertRow(blankPos, row.label, row.editor);
+            row.label->show();
+            row.editor->show();
+            row.layout = target;
         }
-        ui->dynamicFieldEdits.insert(f, editor);
+        if (target == activeLayout) ++activePos; else ++blankPos;
+        ui->dynamicFieldEdits.insert(row.field, row.editor);
     }
 }
@@ -0,0 +1,105 @@
+#include "Identifiers.h"
+#include <cstring>
+
+namespace {
+
+char asciiLower(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+std::string lowerTrimmed(const std::string &s) {
+    size_t b = 0, e = s.size();
+    while (b < e && isSpace(s[b])) ++b;
+    while (e > b && isSpace(s[e - 1])) --e;
+    std::string out;
+    out.reserve(e - b);
+    for (size_t i = b; i < e; ++i) out += asciiLower(s[i]);
+    return out;
+}
+
+bool startsWith(const std::string &s, size_t pos, const char *prefix) {
+    return s.compare(pos, std::strlen(prefix), prefix) == 0;
+}
+
+bool validISBN10(const std::string &d) {
+    int sum = 0;
+    for (size_t k = 0; k < 10; ++k) sum += (d[k] == 'X' ? 10 : d[k] - '0') * int(10 - k);
+    return sum % 11 == 0;
+}
+
+} // namespace
+
+std::string normalizeDOI(const std::string &doi) {
+    std::string s;
+    s.reserve(doi.size());
+    for (char c : doi) s += asciiLower(c);
+    size_t b = 0, e = s.size();
+    while (b < e && isSpace(s[b])) ++b;
+    while (e > b && (isSpace(s[e - 1]) || s[e - 1] == '.' || s[e - 1] == ',' || s[e - 1] == ';')) --e;
+
+    // Longest prefixes first; a URL may carry any of the resolver hosts
+    static const char *const prefixes[] = {
+        "https://", "http://", "www.", "dx.doi.org/", "doi.org/", "info:doi/", "urn:doi:", "doi:",
+    };
+    for (bool stripped = true; stripped;) {
+        stripped = false;
+        for (const char *p : prefixes) {
+            if (startsWith(s, b, p) && b + std::strlen(p) <= e) {
+                b += std::strlen(p);
+                while (b < e && isSpace(s[b])) ++b;
+                stripped = true;
+            }
+        }
+    }
+
+    std::string out;
+    out.reserve(e - b);
+    for (size_t i = b; i < e; ++i) {
+        if (s[i] == '%' && i + 2 < e && s[i + 1] == '2' && s[i + 2] == 'f') {
+            out += '/';
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+std::string normalizeISBN(const std::string &isbn) {
+    // Try each run of digits in turn, so labels like "ISBN-13:" are skipped
+    size_t i = 0;
+    while (i < isbn.size()) {
+        while (i < isbn.size() && !isDigit(isbn[i])) ++i;
+        std::string digits;
+        for (; i < isbn.size() && digits.size() < 13; ++i) {
+            char c = isbn[i];
+            if (isDigit(c)) digits += c;
+            else if ((c == 'X' || c == 'x') && digits.size() == 9) digits += 'X';
+            else if (c == ' ' && digits.size() == 10 && validISBN10(digits)) break; // "0306406152 9780306406157"
+            else if (c != '-' && c != ' ') break;
+            if (digits.size() == 10 && digits.back() == 'X') { ++i; break; }
+        }
+        // A 10-digit ISBN followed by more digits ends at 10
+        if (digits.size() > 10 && digits.size() < 13) digits.resize(10);
+
+        if (digits.size() == 13 && digits.back() != 'X') return digits;
+        if (digits.size() == 10) {
+            std::string out = "978" + digits.substr(0, 9);
+            int sum = 0;
+            for (size_t k = 0; k < 12; ++k) sum += (out[k] - '0') * (k % 2 ? 3 : 1);
+            out += char('0' + (10 - sum % 10) % 10);
+            return out;
+        }
+    }
+    return std::string();
+}
+
+std::vector<std::string> identityKeys(const Item &it) {
+    std::vector<std::string> keys;
+    const std::string doi = normalizeDOI(it.doi), isbn = normalizeISBN(it.isbn);
+    if (!doi.empty()) keys.push_back("doi:" + doi);
+    if (!isbn.empty()) keys.push_back("isbn:" + isbn);
+    const std::string title = lowerTrimmed(it.title), authors = lowerTrimmed(it.authors);
+    if (!title.empty() && !authors.empty()) keys.push_back("ta:" + title + "\x1f" + authors);
+    return keys;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Database.h"
+#include <string>
+#include <vector>
+
+// Canonical forms of DOIs and ISBNs, stored in items.doi_norm / items.isbn13 and
+// used for every identifier match. No Qt dependency.
+
+// Lowercased DOI without resolver or scheme prefix ("https://doi.org/",
+// "dx.doi.org/", "doi:", "info:doi/"), "%2F" decoded and trailing punctuation
+// dropped; "" when nothing is left.
+std::string normalizeDOI(const std::string &doi);
+
+// The 13 digits of the first ISBN in `isbn` (ISBN-10 converted with a fresh
+// check digit), ignoring hyphens, spaces and an "ISBN" label; "" when there is
+// no 10- or 13-digit ISBN.
+std::string normalizeISBN(const std::string &isbn);
+
+// Keys under which two items count as the same reference, strongest first:
+// "doi:" + normalized DOI, "isbn:" + ISBN-13, then "ta:" + lowercased, trimmed
+// title and authors (only when both are present). Database::findExistingItems
+// applies the same rules in SQL.
+std::vector<std::string> identityKeys(const Item &it);
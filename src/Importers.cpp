@@ -0,0 +1,601 @@
+#include "Importers.h"
+#include "Attachments.h"
+#include "Dedupe.h"
+#include "Identifiers.h"
+#include "UUID.h"
+#include <QFile>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegularExpression>
+#include <QMap>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Clean a BibTeX field value: strip outer braces/quotes, unescape
+QString cleanBibTeXValue(QString s) {
+    s = s.trimmed();
+    // Remove ALL outer braces iteratively (handles {{text}} -> text)
+    while (s.size() >= 2 && s.startsWith('{') && s.endsWith('}')) {
+        s = s.mid(1, s.size() - 2);
+    }
+    // Remove outer quotes
+    while (s.size() >= 2 && s.startsWith('"') && s.endsWith('"')) {
+        s = s.mid(1, s.size() - 2);
+    }
+    // Unescape common LaTeX
+    s.replace("\\{", "{").replace("\\}", "}").replace("\\%", "%");
+    s.replace("\\&", "&").replace("\\_", "_").replace("\\$", "$");
+    // Remove a trailing comma if present (messy BibTeX often leaves a trailing comma)
+    s = s.trimmed();
+    if (s.endsWith(',')) s.chop(1);
+
+    // Remove any remaining braces used to protect capitalization (e.g. "{Mathematical}" -> "Mathematical")
+    s.replace('{', ' ');
+    s.replace('}', ' ');
+
+    // Collapse multiple whitespace into single space and trim again
+    s = s.replace(QRegularExpression("\\s+"), " ").trimmed();
+
+    return s;
+}
+
+QString sanitizeStorageName(const QString &in) {
+    QString s = in;
+    s = s.replace(QRegularExpression("[^A-Za-z0-9_\\-]"), "_");
+    // Collapse multiple underscores
+    s = s.replace(QRegularExpression("_+"), "_");
+    return s;
+}
+
+// Storage base for copying attached files
+std::filesystem::path bibStoragePath() {
+    return std::filesystem::path(std::getenv("HOME")) / ".local" / "share" / "bello" / "storage";
+}
+
+} // namespace
+
+std::vector<BibTeXEntryRange> scanBibTeXEntries(const QByteArray &content, bool *complete) {
+    std::vector<BibTeXEntryRange> out;
+    const qsizetype len = content.size();
+    if (complete) *complete = true;
+    qsizetype pos = 0;
+    while (true) {
+        qsizetype at = content.indexOf('@', pos);
+        if (at < 0) break;
+
+        // Find the opening delimiter (either '{' or '(' )
+        qsizetype startBrace = content.indexOf('{', at);
+        qsizetype startParen = content.indexOf('(', at);
+        qsizetype start = -1;
+        char openChar = '{';
+        char closeChar = '}';
+        if (startBrace >= 0 && (startParen < 0 || startBrace < startParen)) {
+            start = startBrace;
+        } else if (startParen >= 0) {
+            start = startParen;
+            openChar = '('; closeChar = ')';
+        }
+        if (start < 0) {
+            // A trailing "@word" starting a token is an entry cut off before its delimiter;
+            // anything else (say an address) is text between entries
+            qsizetype j = at + 1;
+            while (j < len && (std::isalnum((unsigned char)content.at(j)) || std::isspace((unsigned char)content.at(j)))) ++j;
+            const bool tokenStart = at == 0 || std::isspace((unsigned char)content.at(at - 1));
+            if (complete && tokenStart && j == len) *complete = false;
+            break;
+        }
+
+        // Find matching close, accounting for nested pairs of the chosen delimiter.
+        // The delimiters are ASCII, so byte offsets work for UTF-8 content.
+        qsizetype i = start + 1;
+        int depth = 1;
+        while (i < len && depth > 0) {
+            char c = content.at(i);
+            if (c == openChar) depth++;
+            else if (c == closeChar) depth--;
+            ++i;
+        }
+        if (depth != 0) {
+            if (complete) *complete = false;
+            break;
+        }
+
+        BibTeXEntryRange r;
+        r.begin = at;
+        r.end = i;
+        r.type = QString::fromUtf8(content.mid(at + 1, start - at - 1)).trimmed().toLower();
+        // Citation key: everything before the first comma
+        qsizetype comma = content.indexOf(',', start + 1);
+        if (comma >= 0 && comma < i - 1) r.key = QString::fromUtf8(content.mid(start + 1, comma - start - 1)).trimmed();
+        out.push_back(std::move(r));
+        pos = i;
+    }
+    return out;
+}
+
+bool parseBibTeXEntry(const QByteArray &entry, const QString &bibPath, Item &cur, bool copyFiles) {
+    QString content = QString::fromUtf8(entry);
+    int startBrace = content.indexOf('{');
+    int startParen = content.indexOf('(');
+    int start = (startBrace >= 0 && (startParen < 0 || startBrace < startParen)) ? startBrace : startParen;
+    if (start < 0 || content.size() < start + 2) return false;
+
+    // Extract the entry content (without outer braces)
+    QString entryBlock = content.mid(start + 1, content.size() - start - 2);
+
+    // Extract entry type (word after '@' and before the opening brace/paren)
+    QString entryType = content.mid(1, start - 1).trimmed().toLower();
+
+    // Find the citation key (everything before first comma)
+    int comma = entryBlock.indexOf(',');
+    QString citationKey = (comma >= 0) ? entryBlock.left(comma).trimmed() : QString();
+    QString fields = (comma >= 0) ? entryBlock.mid(comma + 1) : entryBlock;
+
+    cur = Item();
+    cur.type = entryType.toStdString();
+    int j = 0;
+    int flen = fields.size();
+
+    auto skipWs = [&]() { while (j < flen && fields.at(j).isSpace()) ++j; };
+
+    while (j < flen) {
+        skipWs();
+        if (j >= flen) break;
+
+        // Parse field name
+        int nameStart = j;
+        while (j < flen && (fields.at(j).isLetterOrNumber() || fields.at(j) == '_' || fields.at(j) == '-')) ++j;
+        QString name = fields.mid(nameStart, j - nameStart).trimmed().toLower();
+        
+        skipWs();
+        if (j >= flen || fields.at(j) != '=') {
+            // Skip to next comma or end
+            while (j < flen && fields.at(j) != ',') ++j;
+            if (j < flen) ++j;
+            continue;
+        }
+        ++j; // skip '='
+        skipWs();
+
+        // Parse field value
+        QString value;
+        if (j < flen && fields.at(j) == '{') {
+            // Brace-delimited value - find matching close
+            int vstart = j + 1;
+            int vdepth = 1;
+            ++j;
+            while (j < flen && vdepth > 0) {
+                if (fields.at(j) == '{') vdepth++;
+                else if (fields.at(j) == '}') vdepth--;
+                if (vdepth > 0) ++j;
+            }
+            value = fields.mid(vstart, j - vstart);
+            if (j < flen) ++j; // skip closing }
+        } else if (j < flen && fields.at(j) == '"') {
+            // Quote-delimited value
+            int vstart = j + 1;
+            ++j;
+            while (j < flen && fields.at(j) != '"') {
+                if (fields.at(j) == '\\' && j + 1 < flen) j += 2;
+                else ++j;
+            }
+            value = fields.mid(vstart, j - vstart);
+            if (j < flen) ++j; // skip closing "
+        } else {
+            // Unquoted value (number or string concatenation)
+            int vstart = j;
+            // Stop at comma, but not at } (which ends the entry, handled by outer loop)
+            while (j < flen && fields.at(j) != ',') {
+                // Handle nested braces if someone writes year = {2020}
+                if (fields.at(j) == '{') {
+                    int vdepth = 1;
+                    ++j;
+                    while (j < flen && vdepth > 0) {
+                        if (fields.at(j) == '{') vdepth++;
+                        else if (fields.at(j) == '}') vdepth--;
+                        ++j;
+                    }
+                } else {
+                    ++j;
+                }
+            }
+            value = fields.mid(vstart, j - vstart);
+        }
+
+        value = cleanBibTeXValue(value);
+
+        // Assign to Item fields (include common BibTeX keys)
+        if (name == "title") cur.title = value.toStdString();
+        else if (name == "author") cur.authors = value.toStdString();
+        else if (name == "year") cur.year = value.toStdString();
+        else if (name == "doi") cur.doi = value.toStdString();
+        else if (name == "isbn") cur.isbn = value.toStdString();
+        else if (name == "abstract") cur.abstract = value.toStdString();
+        else if (name == "address") cur.address = value.toStdString();
+        else if (name == "publisher") cur.publisher = value.toStdString();
+        else if (name == "editor") cur.editor = value.toStdString();
+        else if (name == "booktitle") cur.booktitle = value.toStdString();
+        else if (name == "series") cur.series = value.toStdString();
+        else if (name == "edition") cur.edition = value.toStdString();
+        else if (name == "chapter") cur.chapter = value.toStdString();
+        else if (name == "school") cur.school = value.toStdString();
+        else if (name == "institution") cur.institution = value.toStdString();
+        else if (name == "organization") cur.organization = value.toStdString();
+        else if (name == "howpublished") cur.howpublished = value.toStdString();
+        else if (name == "language") cur.language = value.toStdString();
+        else if (name == "url") cur.url = value.toStdString();
+        else if (name == "journal") cur.journal = value.toStdString();
+        else if (name == "pages") cur.pages = value.toStdString();
+        else if (name == "volume") cur.volume = value.toStdString();
+        else if (name == "number") cur.number = value.toStdString();
+        else if (name == "keywords") cur.keywords = value.toStdString();
+        else if (name == "month") cur.month = value.toStdString();
+        else if (name == "note") cur.note = value.toStdString();
+        else if (name == "file") {
+            // Zotero file field format: "Desc:path:mime;Desc2:path2:mime2"
+            auto parts = value.split(';', Qt::SkipEmptyParts);
+            for (const QString &p : parts) {
+                QString seg = p.trimmed();
+                QStringList cols = seg.split(':');
+                QString pathCandidate;
+                if (cols.size() >= 3) {
+                    // Format: Description:path:mimetype
+                    pathCandidate = cols[1];
+                } else if (cols.size() == 2) {
+                    pathCandidate = cols[1];
+                } else {
+                    pathCandidate = seg;
+                }
+                pathCandidate = pathCandidate.trimmed();
+                if (pathCandidate.isEmpty()) continue;
+
+                // Resolve relative to .bib file location
+                QFileInfo bibfi(bibPath);
+                QDir bibDir(bibfi.absolutePath());
+                QString absPath = bibDir.absoluteFilePath(pathCandidate);
+
+                if (copyFiles && QFile::exists(absPath)) {
+                    // Determine storage folder name
+                    QString baseName;
+                    if (!cur.doi.empty()) {
+                        baseName = sanitizeStorageName(QString::fromStdString(cur.doi));
+                    } else if (!cur.isbn.empty()) {
+                        baseName = sanitizeStorageName(QString::fromStdString(cur.isbn));
+                    } else if (!citationKey.isEmpty()) {
+                        baseName = sanitizeStorageName(citationKey);
+                    } else {
+                        QString a = QString::fromStdString(cur.authors).section(',', 0, 0).trimmed();
+                        if (a.isEmpty()) a = "unknown";
+                        QString y = QString::fromStdString(cur.year);
+                        if (y.isEmpty()) y = "0000";
+                        baseName = sanitizeStorageName(a + "_" + y);
+                    }
+
+                    std::filesystem::path targetDir = bibStoragePath() / baseName.toStdString();
+                    std::filesystem::create_directories(targetDir);
+
+                    QFileInfo src(absPath);
+                    std::filesystem::path dest = targetDir / src.fileName().toStdString();
+
+                    // Avoid overwrite
+                    int idx = 1;
+                    while (std::filesystem::exists(dest)) {
+                        std::string stem = src.completeBaseName().toStdString();
+                        std::string ext = src.suffix().isEmpty() ? "" : "." + src.suffix().toStdString();
+                        dest = targetDir / (stem + "_" + std::to_string(idx) + ext);
+                        ++idx;
+                    }
+
+                    try {
+                        std::filesystem::copy_file(absPath.toStdString(), dest);
+                        if (cur.pdf_path.empty()) {
+                            cur.pdf_path = dest.string();
+                        } else {
+                            // Append additional files separated by ;
+                            cur.pdf_path += ";" + dest.string();
+                        }
+                    } catch (...) {
+                        // Ignore copy errors
+                    }
+                }
+            }
+        } else {
+            // unknown field: append to note as plain text for round-trip fidelity
+            QString pair = QString("%1 = {%2}").arg(name, value);
+            if (cur.note.empty()) cur.note = pair.toStdString();
+            else cur.note += std::string("; ") + pair.toStdString();
+        }
+
+        // Skip trailing comma
+        skipWs();
+        if (j < flen && fields.at(j) == ',') ++j;
+    }
+
+    // Keep the entry if it has any meaningful data (title/authors/identifiers/files/notes)
+    return !cur.title.empty() || !cur.authors.empty() || !cur.doi.empty() || !cur.isbn.empty() || !cur.pdf_path.empty() || !citationKey.isEmpty() || !cur.url.empty() || !cur.note.empty();
+}
+
+std::vector<Item> parseBibTeXFile(const QString &path) {
+    std::vector<Item> out;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return out;
+    const QByteArray all = f.readAll();
+    for (const auto &r : scanBibTeXEntries(all)) {
+        Item cur;
+        if (parseBibTeXEntry(all.mid(r.begin, r.end - r.begin), path, cur)) out.push_back(std::move(cur));
+    }
+    return out;
+}
+
+std::vector<Item> parseZoteroRDFFile(const QString &path) {
+    std::vector<Item> out;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return out;
+    QString content = QString::fromUtf8(f.readAll());
+
+    // First pass: collect attachments mapping (about id -> list of resource paths)
+    QMap<QString, QStringList> attachMap;
+    QRegularExpression attachRx("<z:Attachment[^>]*rdf:about=\\\"([^\\\"]+)\\\"[\\s\\S]*?</z:Attachment>", QRegularExpression::DotMatchesEverythingOption);
+    QRegularExpression resourceRx("files/[^\"'\\s>]+");
+    auto attachIt = attachRx.globalMatch(content);
+    while (attachIt.hasNext()) {
+        auto m = attachIt.next();
+        QString about = m.captured(1); // e.g. #item_217
+        QString block = m.captured(0);
+        QRegularExpressionMatch resMatch = resourceRx.match(block);
+        if (resMatch.hasMatch()) {
+            QString rel = resMatch.captured(0);
+            attachMap[about].append(rel);
+        }
+    }
+
+    // Second pass: parse items
+    QTextStream ts(&f);
+    f.seek(0);
+    Item cur;
+    QString curAbout;
+    QStringList pendingAttachIds;
+    while (!ts.atEnd()) {
+        QString line = ts.readLine();
+        if (line.contains("<rdf:Description") && line.contains("rdf:about=")) {
+            // New description block
+            // push previous
+            if (!cur.title.empty() || !cur.authors.empty() || !cur.doi.empty() || !cur.isbn.empty()) {
+                // Attach any pending files
+                for (const QString &aid : pendingAttachIds) {
+                    if (attachMap.contains(aid)) {
+                        for (const QString &rel : attachMap[aid]) {
+                            QFileInfo rdfFi(path);
+                            QDir rdfDir(rdfFi.absolutePath());
+                            QString abs = rdfDir.absoluteFilePath(rel);
+                            if (QFile::exists(abs)) {
+                                if (!cur.pdf_path.empty()) cur.pdf_path += ";";
+                                cur.pdf_path += abs.toStdString();
+                            }
+                        }
+                    }
+                }
+                out.push_back(cur);
+            }
+            cur = Item{};
+            curAbout.clear();
+            pendingAttachIds.clear();
+            // capture about id if present
+            QRegularExpression aboutRx("rdf:about=\"([^\"]+)\"");
+            QRegularExpressionMatch am = aboutRx.match(line);
+            if (am.hasMatch()) curAbout = am.captured(1);
+        }
+        if (line.contains("<dc:title>")) {
+            cur.title = line.section("<dc:title>", 1).section("</dc:title>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<dc:creator>")) {
+            cur.authors = line.section("<dc:creator>", 1).section("</dc:creator>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<dc:date>")) {
+            cur.year = line.section("<dc:date>", 1).section("</dc:date>", 0, 0).trimmed().left(4).toStdString();
+        }
+        if (line.contains("<dc:publisher>") || line.contains("<bib:publisher>") || line.contains("<dcterms:publisher>")) {
+            QString v = line;
+            v.remove(QRegularExpression("<[^>]+>"));
+            cur.publisher = v.trimmed().toStdString();
+        }
+        if (line.contains("<bib:doi>") || line.contains("<dc:identifier>")) {
+            // Try to pick DOI or ISBN-like identifier
+            QString idval = line;
+            idval.remove(QRegularExpression("<[^>]+>"));
+            idval = idval.trimmed();
+            if (idval.contains("ISBN", Qt::CaseInsensitive)) {
+                // extract digits and hyphens
+                QRegularExpression isbnRx("(97[89][- ]?[0-9][-0-9 ]+)");
+                auto m = isbnRx.match(idval);
+                if (m.hasMatch()) cur.isbn = m.captured(1).trimmed().toStdString();
+            } else if (idval.contains("10.") || idval.contains("doi:" , Qt::CaseInsensitive)) {
+                // crude DOI extraction
+                QRegularExpression doiRx("(10\\.[^\\s]+)");
+                auto m = doiRx.match(idval);
+                if (m.hasMatch()) cur.doi = m.captured(1).trimmed().toStdString();
+            }
+        }
+        if (line.contains("link:link") && line.contains("rdf:resource=")) {
+            // references an attachment id e.g. rdf:resource="#item_217"
+            QRegularExpression linkRx("rdf:resource=\"([^\"]+)\"");
+            auto lm = linkRx.match(line);
+            if (lm.hasMatch()) {
+                QString aid = lm.captured(1);
+                pendingAttachIds << aid;
+            }
+        }
+    }
+    // push last
+    if (!cur.title.empty() || !cur.authors.empty() || !cur.doi.empty() || !cur.isbn.empty()) {
+        for (const QString &aid : pendingAttachIds) {
+            if (attachMap.contains(aid)) {
+                for (const QString &rel : attachMap[aid]) {
+                    QFileInfo rdfFi(path);
+                    QDir rdfDir(rdfFi.absolutePath());
+                    QString abs = rdfDir.absoluteFilePath(rel);
+                    if (QFile::exists(abs)) {
+                        if (!cur.pdf_path.empty()) cur.pdf_path += ";";
+                        cur.pdf_path += abs.toStdString();
+                    }
+                }
+            }
+        }
+        out.push_back(cur);
+    }
+    return out;
+}
+
+std::vector<Item> parseEndNoteXMLFile(const QString &path) {
+    std::vector<Item> out;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return out;
+    QTextStream ts(&f);
+    Item cur;
+    while (!ts.atEnd()) {
+        QString line = ts.readLine();
+        if (line.contains("<record>")) {
+            if (!cur.title.empty() || !cur.authors.empty()) out.push_back(cur);
+            cur = Item{};
+        }
+        if (line.contains("<title>")) {
+            cur.title = line.section("<title>", 1).section("</title>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<author>")) {
+            cur.authors = line.section("<author>", 1).section("</author>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<year>")) {
+            cur.year = line.section("<year>", 1).section("</year>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<publisher>")) {
+            cur.publisher = line.section("<publisher>", 1).section("</publisher>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<electronic-resource-num>")) {
+            cur.doi = line.section("<electronic-resource-num>", 1).section("</electronic-resource-num>", 0, 0).trimmed().toStdString();
+        }
+    }
+    if (!cur.title.empty() || !cur.authors.empty()) out.push_back(cur);
+    return out;
+}
+
+std::vector<Item> parseMendeleyXMLFile(const QString &path) {
+    std::vector<Item> out;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return out;
+    QTextStream ts(&f);
+    Item cur;
+    while (!ts.atEnd()) {
+        QString line = ts.readLine();
+        if (line.contains("<document>")) {
+            if (!cur.title.empty() || !cur.authors.empty()) out.push_back(cur);
+            cur = Item{};
+        }
+        if (line.contains("<title>")) {
+            cur.title = line.section("<title>", 1).section("</title>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<authors>")) {
+            QString a = line;
+            a.remove("<authors>").remove("</authors>").remove("<author>").remove("</author>");
+            cur.authors = a.trimmed().toStdString();
+        }
+        if (line.contains("<publisher>")) {
+            cur.publisher = line.section("<publisher>", 1).section("</publisher>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<year>")) {
+            cur.year = line.section("<year>", 1).section("</year>", 0, 0).trimmed().toStdString();
+        }
+        if (line.contains("<doi>")) {
+            cur.doi = line.section("<doi>", 1).section("</doi>", 0, 0).trimmed().toStdString();
+        }
+    }
+    if (!cur.title.empty() || !cur.authors.empty()) out.push_back(cur);
+    return out;
+}
+
+ImportStats importItems(Database &db, std::vector<Item> items, const std::string &collection, bool mergeExisting) {
+    const size_t batchSize = 10000;
+    ImportStats stats;
+    stats.ids.reserve(items.size());
+    for (size_t start = 0; start < items.size(); start += batchSize) {
+        std::vector<Item> batch(std::make_move_iterator(items.begin() + start),
+                                std::make_move_iterator(items.begin() + std::min(items.size(), start + batchSize)));
+        std::vector<Item> toInsert;
+        toInsert.reserve(batch.size());
+        if (!mergeExisting) {
+            for (auto &it : batch) {
+                it.id = gen_uuid();
+                it.collection = collection;
+                stats.ids.push_back(it.id);
+                toInsert.push_back(std::move(it));
+            }
+            db.addItems(toInsert);
+            stats.added += toInsert.size();
+            continue;
+        }
+
+        // Matches in the library; entries of earlier batches are there already
+        const std::vector<std::string> existing = db.findExistingItems(batch);
+        std::vector<std::string> matchedIds;
+        for (const auto &id : existing) {
+            if (!id.empty()) matchedIds.push_back(id);
+        }
+        std::unordered_map<std::string, Item> matched;
+        if (!matchedIds.empty()) {
+            for (auto &it : db.getItems(matchedIds)) matched.emplace(it.id, std::move(it));
+        }
+        std::unordered_set<std::string> changed;
+        std::vector<std::pair<std::string, std::string>> memberships, attachments;
+        std::unordered_map<std::string, size_t> seen; // identity key -> index in toInsert
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Item &it = batch[i];
+            auto m = existing[i].empty() ? matched.end() : matched.find(existing[i]);
+            if (m != matched.end()) {
+                if (mergeItemFields(m->second, it)) changed.insert(m->first);
+                if (!collection.empty()) memberships.emplace_back(m->first, collection);
+                for (auto &p : splitAttachmentPaths(it.pdf_path)) attachments.emplace_back(m->first, std::move(p));
+                stats.ids.push_back(m->first);
+                ++stats.merged;
+                continue;
+            }
+            std::vector<std::string> keys = identityKeys(it);
+            auto s = seen.end();
+            for (const auto &k : keys) {
+                if ((s = seen.find(k)) != seen.end()) break;
+            }
+            const size_t target = s != seen.end() ? s->second : toInsert.size();
+            for (auto &k : keys) seen.emplace(std::move(k), target);
+            if (target < toInsert.size()) {
+                mergeItemFields(toInsert[target], it);
+                // addItems splits pdf_path and drops repeated paths
+                if (!it.pdf_path.empty()) toInsert[target].pdf_path += ";" + it.pdf_path;
+                stats.ids.push_back(toInsert[target].id);
+                ++stats.merged;
+                continue;
+            }
+            it.id = gen_uuid();
+            it.collection = collection;
+            stats.ids.push_back(it.id);
+            toInsert.push_back(std::move(it));
+        }
+
+        if (!changed.empty()) {
+            std::vector<Item> updates;
+            updates.reserve(changed.size());
+            for (const auto &id : changed) updates.push_back(std::move(matched[id]));
+            db.updateItems(updates);
+        }
+        if (!memberships.empty()) db.addItemsToCollections(memberships);
+        if (!attachments.empty()) db.addAttachments(attachments);
+        if (!toInsert.empty()) db.addItems(toInsert);
+        stats.added += toInsert.size();
+    }
+    return stats;
+}
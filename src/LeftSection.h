@@ -16,6 +16,7 @@
 #include <QDir>
 
 #include "Importers.h"
+#include "BibTeX.h"
 
 // Forward declaration to avoid circular dependency
 class MainWindow;
@@ -42,6 +43,24 @@ inline void MainWindow::onCollectionContextMenuRequested(const QPoint &pos) {
 
     menu.addSeparator();
     menu.addAction("Import Items…", [this, collection](){ importItemsDialog(collection); });
+    menu.addAction("Link .bib File…", [this, collection](){ linkBibFileDialog(collection); });
+    QMenu *unlinkMenu = nullptr;
+    for (const auto &f : db->listLinkedBibFiles()) {
+        if (QString::fromStdString(f.collection) != collection) continue;
+        if (!unlinkMenu) unlinkMenu = menu.addMenu("Unlink .bib File");
+        const QString path = QString::fromStdString(f.path);
+        unlinkMenu->addAction(QFileInfo(path).fileName(), [this, path](){ unlinkBibFile(path); })->setToolTip(path);
+    }
+    menu.addAction("Export…", [this, collection](){ exportCollection(collection); });
+    menu.addAction("Keep Exported as .bib…", [this, collection](){ keepExportedDialog(collection); });
+    QMenu *stopMenu = nullptr;
+    for (const auto &e : db->listLiveExports()) {
+        if (QString::fromStdString(e.collection) != collection) continue;
+        if (!stopMenu) stopMenu = menu.addMenu("Stop Keeping Exported");
+        const QString path = QString::fromStdString(e.path);
+        stopMenu->addAction(QFileInfo(path).fileName(), [this, path](){ stopLiveExport(path); })->setToolTip(path);
+    }
+    if (collection.isEmpty()) menu.addAction("Find Duplicates…", [this](){ findDuplicates(); });
 
     menu.exec(ui->collectionsList->viewport()->mapToGlobal(pos));
 }
@@ -72,56 +91,7 @@ inline void MainWindow::deleteCollection(const QString &name) {
         // Perform the delete operation
         db->deleteCollection(name.toStdString());
         
-        // Manual reload with updated paths to avoid issues
-        ui->collectionsList->clear();
-        ui->itemsList->clear();
-        ui->collectionCheckList->clear();
-
-        auto collections = db->listCollections();
-
-        // Populate checkable collections list
-        for (const auto &collection : collections) {
-            QString path = QString::fromStdString(collection);
-            auto *checkItem = new QListWidgetItem(path);
-            checkItem->setFlags(checkItem->flags() | Qt::ItemIsUserCheckable);
-            checkItem->setCheckState(Qt::Unchecked);
-            checkItem->setData(Qt::UserRole, path);
-            ui->collectionCheckList->addItem(checkItem);
-        }
-
-        auto *allItems = new QTreeWidgetItem(ui->collectionsList);
-        allItems->setText(0, "All Items");
-        allItems->setData(0, Qt::UserRole, "");
-
-        for (const auto &collection : collections) {
-            QString path = QString::fromStdString(collection);
-            QTreeWidgetItem *parent = allItems;
-            const auto parts = path.split('/', Qt::SkipEmptyParts);
-            QString accum;
-            for (int i = 0; i < parts.size(); ++i) {
-                accum = accum.isEmpty() ? parts[i] : accum + "/" + parts[i];
-                parent = ensureChild(parent, parts[i]);
-                parent->setData(0, Qt::UserRole, accum);
-            }
-        }
-
-        restoreExpandedPaths(filteredExpanded);
-        ui->collectionsList->expandItem(allItems);
-
-        QTreeWidgetItem *selectItem = allItems;
-        if (!selectedPath.isEmpty()) {
-            QTreeWidgetItem *parent = allItems;
-            const auto parts = selectedPath.split('/', Qt::SkipEmptyParts);
-            QString accum;
-            for (int i = 0; i < parts.size(); ++i) {
-                parent = ensureChild(parent, parts[i]);
-                accum = accum.isEmpty()? parts[i] : accum + "/" + parts[i];
-                parent->setData(0, Qt::UserRole, accum);
-            }
-            selectItem = parent;
-        }
-        ui->collectionsList->setCurrentItem(selectItem);
-        onCollectionSelected();
+        rebuildCollectionTree(filteredExpanded, selectedPath);
     }
 }
 
@@ -174,70 +144,31 @@ inline void MainWindow::renameCollection(const QString &oldName) {
         // Perform the rename operation
         db->renameCollection(oldName.toStdString(), newName.toStdString());
         
-        // Manual reload with updated paths to avoid creating duplicate entries
-        ui->collectionsList->clear();
-        ui->itemsList->clear();
-        ui->collectionCheckList->clear();
-
-        auto collections = db->listCollections();
-
-        // Populate checkable collections list
-        for (const auto &collection : collections) {
-            QString path = QString::fromStdString(collection);
-            auto *checkItem = new QListWidgetItem(path);
-            checkItem->setFlags(checkItem->flags() | Qt::ItemIsUserCheckable);
-            checkItem->setCheckState(Qt::Unchecked);
-            checkItem->setData(Qt::UserRole, path);
-            ui->collectionCheckList->addItem(checkItem);
-        }
-
-        auto *allItems = new QTreeWidgetItem(ui->collectionsList);
-        allItems->setText(0, "All Items");
-        allItems->setData(0, Qt::UserRole, "");
-
-        for (const auto &collection : collections) {
-            QString path = QString::fromStdString(collection);
-            QTreeWidgetItem *parent = allItems;
-            const auto parts = path.split('/', Qt::SkipEmptyParts);
-            QString accum;
-            for (int i = 0; i < parts.size(); ++i) {
-                accum = accum.isEmpty() ? parts[i] : accum + "/" + parts[i];
-                parent = ensureChild(parent, parts[i]);
-                parent->setData(0, Qt::UserRole, accum);
-            }
-        }
-
-        restoreExpandedPaths(expanded);
-        ui->collectionsList->expandItem(allItems);
-
-        QTreeWidgetItem *selectItem = allItems;
-        if (!selectedPath.isEmpty()) {
-            QTreeWidgetItem *parent = allItems;
-            const auto parts = selectedPath.split('/', Qt::SkipEmptyParts);
-            QString accum;
-            for (int i = 0; i < parts.size(); ++i) {
-                parent = ensureChild(parent, parts[i]);
-                accum = accum.isEmpty()? parts[i] : accum + "/" + parts[i];
-                parent->setData(0, Qt::UserRole, accum);
-            }
-            selectItem = parent;
-        }
-        ui->collectionsList->setCurrentItem(selectItem);
-        onCollectionSelected();
+        rebuildCollectionTree(expanded, selectedPath);
     }
 }
 
 inline void MainWindow::exportCollection(const QString &name) {
-    QString filename = QFileDialog::getSaveFileName(this, "Export Collection", name + ".txt", "Text Files (*.txt)");
+    QString filename = QFileDialog::getSaveFileName(this, "Export Collection", name + ".bib",
+                                                    "BibTeX Files (*.bib);;Text Files (*.txt)");
     if (filename.isEmpty()) return;
     
     QFile file(filename);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, "Export", "Cannot write " + filename);
+        return;
+    }
+    // One query over the collection and its subcollections, written chunk by chunk
+    ItemQuery q;
+    q.limit = 0;
+    q.collection = name.toStdString();
+    if (QFileInfo(filename).suffix().toLower() == "bib") {
+        exportBibTeX(*db, q, bibtex, [&file](const QByteArray &block) { file.write(block); });
+    } else {
         QTextStream out(&file);
-        auto items = db->listItemsInCollection(name.toStdString());
-        for (const auto &it : items) {
-            out << formatCitation(it) << "\n\n";
-        }
+        db->queryItems(q, [&](const std::vector<Item> &chunk) {
+            for (const auto &it : chunk) out << formatCitation(it) << "\n\n";
+        });
     }
 }
 
@@ -258,18 +189,11 @@ inline void MainWindow::createSubcollection(const QString &parent) {
         db->addCollection(fullName.toStdString());
         // Keep expanded state and selection on reload
         reload();
-        // After reload, select and expand the newly created subcollection
-        const auto parts = fullName.split('/', Qt::SkipEmptyParts);
-        auto *root = ui->collectionsList->topLevelItem(0); // All Items
-        QTreeWidgetItem *cur = root;
-        QString accum;
-        for (const auto &p : parts) {
-            cur = ensureChild(cur, p);
-            accum = accum.isEmpty()? p : accum + "/" + p;
-            cur->setData(0, Qt::UserRole, accum);
-            ui->collectionsList->expandItem(cur);
+        // After reload, select the newly created subcollection and expand its ancestors
+        if (QTreeWidgetItem *cur = collectionNode(fullName)) {
+            for (QTreeWidgetItem *n = cur; n; n = n->parent()) ui->collectionsList->expandItem(n);
+            ui->collectionsList->setCurrentItem(cur);
         }
-        ui->collectionsList->setCurrentItem(cur);
     }
 }
 
@@ -285,43 +209,19 @@ inline QString MainWindow::itemPath(QTreeWidgetItem* item) const {
 
 inline QStringList MainWindow::collectExpandedPaths() const {
     QStringList paths;
-    auto *root = ui->collectionsList->topLevelItem(0);
-    if (!root) return paths;
-    std::function<void(QTreeWidgetItem*)> dfs = [&](QTreeWidgetItem *n){
-        if (!n) return;
-        if (n->isExpanded()) {
-            QString p = itemPath(n);
-            if (!p.isEmpty()) paths << p;
-        }
-        for (int i=0;i<n->childCount();++i) dfs(n->child(i));
-    };
-    dfs(root);
+    for (auto it = ui->collectionNodes.cbegin(); it != ui->collectionNodes.cend(); ++it) {
+        if (!it.key().isEmpty() && it.value()->isExpanded()) paths << it.key();
+    }
     return paths;
 }
 
+// Paths that no longer exist are skipped. Expanding loads each node's children.
 inline void MainWindow::restoreExpandedPaths(const QStringList &paths) {
-    auto *root = ui->collectionsList->topLevelItem(0);
-    if (!root) return;
     for (const auto &p : paths) {
-        QTreeWidgetItem *n = root;
-        const auto parts = p.split('/', Qt::SkipEmptyParts);
-        for (const auto &seg : parts) {
-            n = ensureChild(n, seg);
-        }
-        ui->collectionsList->expandItem(n);
+        if (QTreeWidgetItem *n = collectionNode(p)) ui->collectionsList->expandItem(n);
     }
 }
 
-inline QTreeWidgetItem* MainWindow::ensureChild(QTreeWidgetItem* parent, const QString &name) {
-    for (int i = 0; i < parent->childCount(); ++i) {
-        auto *ch = parent->child(i);
-        if (ch->text(0) == name) return ch;
-    }
-    auto *created = new QTreeWidgetItem(parent);
-    created->setText(0, name);
-    return created;
-}
-
 inline void MainWindow::importToCollection(const QString &name) {
     QString dir = QFileDialog::getExistingDirectory(this, "Select folder with PDFs to import");
     if (dir.isEmpty()) return;
@@ -377,6 +277,11 @@ inline void MainWindow::importItemsDialog(const QString &targetCollection) {
     v->addWidget(newName);
     connect(cbNew, &QCheckBox::toggled, newName, &QLineEdit::setEnabled);
 
+    QCheckBox *cbMerge = new QCheckBox("Merge entries already in the library");
+    cbMerge->setToolTip("Entries with the same DOI, ISBN or title and authors as an existing item fill its blank fields instead of being added again");
+    cbMerge->setChecked(true);
+    v->addWidget(cbMerge);
+
     // Instructions
     v->addWidget(new QLabel("Supported: .bib, .rdf, .xml"));
 
@@ -399,7 +304,7 @@ inline void MainWindow::importItemsDialog(const QString &targetCollection) {
     connect(bbs, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
 
     // Import logic
-    connect(importBtn, &QPushButton::clicked, this, [this, &dlg, fileEdit, cbNew, newName, targetCollection](){
+    connect(importBtn, &QPushButton::clicked, this, [this, &dlg, fileEdit, cbNew, cbMerge, newName, targetCollection](){
         QString filename = fileEdit->text().trimmed();
         if (filename.isEmpty()) { QMessageBox::information(this, "No file", "Please choose a file to import."); return; }
 
@@ -419,20 +324,23 @@ inline void MainWindow::importItemsDialog(const QString &targetCollection) {
 
         QFileInfo fi(filename);
         QString ext = fi.suffix().toLower();
-        int imported = 0;
+        const bool merge = cbMerge->isChecked();
+        ImportStats imported;
         if (ext == "bib") {
-            imported = importBibTeX(filename, collection);
+            imported = importBibTeX(filename, collection, merge);
         } else if (ext == "rdf") {
-            imported = importZoteroRDF(filename, collection);
+            imported = importZoteroRDF(filename, collection, merge);
         } else if (ext == "xml") {
-            imported = importEndNoteXML(filename, collection);
-            if (imported == 0) imported = importMendeleyXML(filename, collection);
+            imported = importEndNoteXML(filename, collection, merge);
+            if (imported.added + imported.merged == 0) imported = importMendeleyXML(filename, collection, merge);
         } else {
             QMessageBox::information(this, "Unsupported", "Unsupported file type: " + ext);
             return;
         }
 
-        QMessageBox::information(this, "Import", QString("Imported %1 items").arg(imported));
+        QString msg = QString("Imported %1 items").arg(imported.added);
+        if (imported.merged) msg += QString(" (%1 merged into existing items)").arg(imported.merged);
+        QMessageBox::information(this, "Import", msg);
         dlg.accept();
         reload();
     });
@@ -442,35 +350,112 @@ inline void MainWindow::importItemsDialog(const QString &targetCollection) {
     dlg.exec();
 }
 
-inline int MainWindow::importBibTeX(const QString &path, const QString &collection) {
-    auto items = parseBibTeXFile(path);
-    int count = 0;
-    for (auto &it : items) {
-        it.id = gen_uuid();
-        it.collection = collection.toStdString();
-        db->addItem(it);
-        ++count;
+inline ImportStats MainWindow::importBibTeX(const QString &path, const QString &collection, bool merge) {
+    return importItems(*db, parseBibTeXFile(path), collection.toStdString(), merge);
+}
+
+inline ImportStats MainWindow::importZoteroRDF(const QString &path, const QString &collection, bool merge) {
+    return importItems(*db, parseZoteroRDFFile(path), collection.toStdString(), merge);
+}
+
+inline ImportStats MainWindow::importEndNoteXML(const QString &path, const QString &collection, bool merge) {
+    return importItems(*db, parseEndNoteXMLFile(path), collection.toStdString(), merge);
+}
+
+inline ImportStats MainWindow::importMendeleyXML(const QString &path, const QString &collection, bool merge) {
+    return importItems(*db, parseMendeleyXMLFile(path), collection.toStdString(), merge);
+}
+
+inline void MainWindow::linkBibFileDialog(const QString &collection) {
+    QString filename = QFileDialog::getOpenFileName(this, "Link .bib file", "", "BibTeX Files (*.bib);;All Files (*.*)");
+    if (filename.isEmpty()) return;
+    filename = QFileInfo(filename).absoluteFilePath();
+    for (const auto &e : db->listLiveExports()) {
+        if (QString::fromStdString(e.path) == filename) {
+            QMessageBox::warning(this, "Link .bib File", filename + " is kept exported from a collection; stop that first.");
+            return;
+        }
+    }
+    flushPendingEdits();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    LinkedBibSync sync = linkBibliography(*db, filename.toStdString(), collection.toStdString());
+    QApplication::restoreOverrideCursor();
+    watchLinkedBibs();
+    reload();
+    if (!sync.ok) {
+        QMessageBox::warning(this, "Link .bib File", "Could not read " + filename);
+        return;
+    }
+    QMessageBox::information(this, "Link .bib File",
+        QString("Linked %1: %2 entries imported. Bello will follow changes to the file.").arg(QFileInfo(filename).fileName()).arg(sync.added));
+}
+
+inline void MainWindow::unlinkBibFile(const QString &path) {
+    // The items stay in the library; only the link is removed
+    db->unlinkBibFile(path.toStdString());
+    bibWatcher->removePath(path);
+    pendingBibSyncs.remove(path);
+}
+
+inline void MainWindow::watchLinkedBibs() {
+    const QStringList watchedFiles = bibWatcher->files(), watchedDirs = bibWatcher->directories();
+    QStringList paths;
+    for (const auto &f : db->listLinkedBibFiles()) {
+        const QString path = QString::fromStdString(f.path);
+        const QString dir = QFileInfo(path).absolutePath();
+        if (QFileInfo::exists(path) && !watchedFiles.contains(path)) paths << path;
+        if (!watchedDirs.contains(dir) && !paths.contains(dir)) paths << dir;
     }
-    return count;
+    if (!paths.isEmpty()) bibWatcher->addPaths(paths);
 }
 
-inline int MainWindow::importZoteroRDF(const QString &path, const QString &collection) {
-    auto items = parseZoteroRDFFile(path);
-    int count = 0;
-    for (auto &it : items) { it.id = gen_uuid(); it.collection = collection.toStdString(); db->addItem(it); ++count; }
-    return count;
+inline void MainWindow::syncPendingBibs() {
+    const QSet<QString> paths = std::exchange(pendingBibSyncs, QSet<QString>());
+    flushPendingEdits();
+    bool changed = false;
+    for (const QString &path : paths) {
+        LinkedBibSync sync = syncLinkedBib(*db, path.toStdString());
+        if (sync.ok && (sync.added || sync.updated || sync.removed)) changed = true;
+    }
+    // Files replaced by the save are no longer watched
+    watchLinkedBibs();
+    if (changed) reload();
 }
 
-inline int MainWindow::importEndNoteXML(const QString &path, const QString &collection) {
-    auto items = parseEndNoteXMLFile(path);
-    int count = 0;
-    for (auto &it : items) { it.id = gen_uuid(); it.collection = collection.toStdString(); db->addItem(it); ++count; }
-    return count;
+inline void MainWindow::keepExportedDialog(const QString &collection) {
+    const QString label = collection.isEmpty() ? "library" : collection;
+    QString filename = QFileDialog::getSaveFileName(this, "Keep Exported", label + ".bib", "BibTeX Files (*.bib)");
+    if (filename.isEmpty()) return;
+    filename = QFileInfo(filename).absoluteFilePath();
+    // A file that is both imported from and exported to would keep rewriting itself
+    for (const auto &f : db->listLinkedBibFiles()) {
+        if (QString::fromStdString(f.path) == filename) {
+            QMessageBox::warning(this, "Keep Exported", filename + " is a linked bibliography; unlink it first.");
+            return;
+        }
+    }
+    flushPendingEdits();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    LiveExportSync sync = startLiveExport(*db, filename.toStdString(), collection.toStdString(), bibtex.keyPreference());
+    QApplication::restoreOverrideCursor();
+    if (!sync.ok) {
+        db->removeLiveExport(filename.toStdString());
+        QMessageBox::warning(this, "Keep Exported", "Cannot write " + filename);
+        return;
+    }
+    QMessageBox::information(this, "Keep Exported",
+        QString("Exported %1 entries to %2. The file will be updated as the collection changes.").arg(sync.formatted + sync.copied).arg(QFileInfo(filename).fileName()));
 }
 
-inline int MainWindow::importMendeleyXML(const QString &path, const QString &collection) {
-    auto items = parseMendeleyXMLFile(path);
-    int count = 0;
-    for (auto &it : items) { it.id = gen_uuid(); it.collection = collection.toStdString(); db->addItem(it); ++count; }
-    return count;
+inline void MainWindow::stopLiveExport(const QString &path) {
+    // The file stays as it is
+    db->removeLiveExport(path.toStdString());
 }
+
+inline void MainWindow::syncLiveExports() {
+    for (const auto &e : db->listLiveExports()) {
+        LiveExportSync sync = syncLiveExport(*db, e.path);
+        if (!sync.ok) qWarning("Live export: cannot write %s", e.path.c_str());
+    }
+}
+
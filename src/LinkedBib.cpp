@@ -0,0 +1,159 @@
+#include "LinkedBib.h"
+#include "Dedupe.h"
+#include "Importers.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// FNV-1a over the entry's bytes; stable across runs and platforms
+uint64_t entryHash(const char *data, qsizetype size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (qsizetype i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// An entry whose bytes changed since the last sync, parsed
+struct ChangedEntry {
+    LinkedBibEntry entry;
+    Item item;
+    size_t range = 0;    // index into the scanned ranges
+};
+
+} // namespace
+
+LinkedBibSync linkBibliography(Database &db, const std::string &path, const std::string &collection) {
+    const std::string absPath = QFileInfo(QString::fromStdString(path)).absoluteFilePath().toStdString();
+    db.linkBibFile({absPath, collection});
+    return syncLinkedBib(db, absPath);
+}
+
+LinkedBibSync syncLinkedBib(Database &db, const std::string &path) {
+    LinkedBibSync sync;
+    bool linked = false;
+    std::string collection;
+    for (const auto &f : db.listLinkedBibFiles()) {
+        if (f.path == path) { linked = true; collection = f.collection; }
+    }
+    if (!linked) return sync;
+
+    const QString qpath = QString::fromStdString(path);
+    QFile file(qpath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return sync;
+    const QByteArray content = file.readAll();
+    file.close();
+    // Editors often truncate a file before writing it: an empty read is taken for a
+    // save in progress rather than for every entry having been deleted
+    if (content.trimmed().isEmpty()) return sync;
+    // Likewise a file that ends inside an entry: the entries after it would look deleted
+    bool complete = true;
+    const std::vector<BibTeXEntryRange> ranges = scanBibTeXEntries(content, &complete);
+    if (!complete) return sync;
+
+    std::unordered_map<std::string, LinkedBibEntry> previous;
+    for (auto &e : db.getLinkedBibEntries(path)) {
+        const std::string key = e.key;
+        previous.emplace(key, std::move(e));
+    }
+
+    // Hash every entry; parse only those that are new or whose bytes changed
+    std::unordered_set<std::string> present;
+    std::unordered_map<std::string, int> occurrences;
+    std::vector<ChangedEntry> changed, added;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const BibTeXEntryRange &r = ranges[i];
+        if (r.type == "comment" || r.type == "preamble" || r.type == "string") continue;
+        std::string key = r.key.toStdString();
+        const int n = ++occurrences[key];
+        if (key.empty() || n > 1) key += "#" + std::to_string(n);
+        const uint64_t hash = entryHash(content.constData() + r.begin, r.end - r.begin);
+
+        auto prev = previous.find(key);
+        if (prev != previous.end() && prev->second.hash == hash) {
+            present.insert(key);
+            ++sync.unchanged;
+            continue;
+        }
+        const bool isNew = prev == previous.end() || prev->second.itemId.empty();
+        ChangedEntry c;
+        // Attachments are copied for new entries only; an edited entry keeps its item's files
+        if (!parseBibTeXEntry(content.mid(r.begin, r.end - r.begin), qpath, c.item, isNew)) {
+            // Unusable for now (e.g. half edited): the entry keeps its item and last hash
+            if (prev != previous.end()) {
+                present.insert(key);
+                ++sync.unchanged;
+            }
+            continue;
+        }
+        present.insert(key);
+        c.entry = {key, hash, isNew ? std::string() : prev->second.itemId};
+        c.range = i;
+        (isNew ? added : changed).push_back(std::move(c));
+    }
+
+    // Edited entries overwrite the fields they set on their item
+    if (!changed.empty()) {
+        std::vector<std::string> ids;
+        ids.reserve(changed.size());
+        for (const auto &c : changed) ids.push_back(c.entry.itemId);
+        std::unordered_map<std::string, Item> existing;
+        for (auto &it : db.getItems(ids)) existing.emplace(it.id, std::move(it));
+        std::vector<Item> updates;
+        std::unordered_map<std::string, size_t> updateIndex;
+        std::vector<ChangedEntry> kept;
+        for (auto &c : changed) {
+            auto old = existing.find(c.entry.itemId);
+            if (old == existing.end()) {
+                // Its item was deleted in the meantime: import the entry again, attachments included
+                const BibTeXEntryRange &r = ranges[c.range];
+                parseBibTeXEntry(content.mid(r.begin, r.end - r.begin), qpath, c.item);
+                c.entry.itemId.clear();
+                added.push_back(std::move(c));
+                continue;
+            }
+            // Fields the entry sets win; those it lacks (or edited in the app only) are kept
+            Item u = std::move(c.item);
+            mergeItemFields(u, old->second);
+            u.id = old->second.id;
+            u.collection = old->second.collection;
+            u.pdf_path = old->second.pdf_path;
+            auto slot = updateIndex.emplace(u.id, updates.size());
+            if (slot.second) updates.push_back(std::move(u));
+            else updates[slot.first->second] = std::move(u);
+            kept.push_back(std::move(c));
+        }
+        changed = std::move(kept);
+        if (!updates.empty()) db.updateItems(updates);
+        sync.updated = changed.size();
+    }
+
+    // New entries go through the regular import, so they merge into matching items
+    if (!added.empty()) {
+        std::vector<Item> items;
+        items.reserve(added.size());
+        for (auto &c : added) items.push_back(std::move(c.item));
+        ImportStats stats = importItems(db, std::move(items), collection, true);
+        for (size_t i = 0; i < added.size() && i < stats.ids.size(); ++i) added[i].entry.itemId = stats.ids[i];
+        sync.added = added.size();
+    }
+
+    std::vector<LinkedBibEntry> entries;
+    entries.reserve(changed.size() + added.size());
+    for (auto &c : changed) entries.push_back(std::move(c.entry));
+    for (auto &c : added) entries.push_back(std::move(c.entry));
+    std::vector<std::string> removedKeys;
+    for (const auto &p : previous) {
+        if (!present.count(p.first)) removedKeys.push_back(p.first);
+    }
+    const std::vector<std::string> orphans = db.updateLinkedBibEntries(path, entries, removedKeys);
+    db.deleteItems(orphans);
+    sync.removed = removedKeys.size();
+    sync.ok = true;
+    return sync;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Database.h"
+#include <string>
+
+// Linked bibliographies: a .bib file (typically the master file of a LaTeX
+// project) registered with Database::linkBibFile and re-synced whenever it
+// changes. Each entry's bytes are hashed; a sync re-parses only entries whose
+// hash differs from the last sync and applies the difference to the library:
+// new entries are imported (merging into matching items, see importItems),
+// edited entries overwrite the fields they set on their item, and removed
+// entries delete their item unless another linked entry still refers to it.
+// No QtWidgets dependency; the GUI watches the files with QFileSystemWatcher
+// and calls syncLinkedBib.
+
+struct LinkedBibSync {
+    bool ok = false;           // false if the file could not be read, was empty or ends inside an entry (nothing was changed)
+    size_t added = 0;
+    size_t updated = 0;
+    size_t removed = 0;
+    size_t unchanged = 0;
+};
+
+// Link `path` (made absolute) to `collection` and run the first sync
+LinkedBibSync linkBibliography(Database &db, const std::string &path, const std::string &collection);
+
+// Bring the library in line with the current contents of a linked file
+LinkedBibSync syncLinkedBib(Database &db, const std::string &path);
@@ -0,0 +1,144 @@
+#include "LiveExport.h"
+#include "BibTeX.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+const size_t kWindow = 10000;            // items fetched per getItems call
+const qsizetype kFlushBytes = 1 << 20;   // buffered output per write
+
+// FNV-1a, continued from `h`; identifies the content an index was written for
+uint64_t contentHash(const char *data, qsizetype size, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (qsizetype i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+LiveExportSync startLiveExport(Database &db, const std::string &path, const std::string &collection, int keyPref) {
+    const std::string absPath = QFileInfo(QString::fromStdString(path)).absoluteFilePath().toStdString();
+    LiveExport e;
+    e.path = absPath;
+    e.collection = collection;
+    e.keyPref = keyPref;
+    db.addLiveExport(e);
+    return syncLiveExport(db, absPath);
+}
+
+LiveExportSync syncLiveExport(Database &db, const std::string &path) {
+    LiveExportSync sync;
+    LiveExport exp;
+    bool found = false;
+    for (auto &e : db.listLiveExports()) {
+        if (e.path == path) { exp = std::move(e); found = true; }
+    }
+    if (!found) return sync;
+    const QString qpath = QString::fromStdString(path);
+    const std::vector<std::pair<std::string, std::string>> versions = db.listItemVersions(exp.collection);
+
+    // The previous file and its index, trusted only if the file still has the content
+    // the index was written for (a hand edit of the same length changes the hash) and
+    // every indexed range starts an entry
+    QFile old(qpath);
+    uchar *data = nullptr;
+    bool trusted = false;
+    std::unordered_map<std::string, LiveExportEntry> index;
+    if (exp.size >= 0 && old.open(QIODevice::ReadOnly) && old.size() == exp.size) {
+        if (exp.size > 0) data = old.map(0, exp.size);
+        trusted = (exp.size == 0 || data) && contentHash(reinterpret_cast<const char*>(data), exp.size) == exp.hash;
+    }
+    if (trusted) {
+        for (auto &e : db.getLiveExportEntries(path)) {
+            if (e.offset < 0 || e.length <= 0 || e.offset + e.length > exp.size || data[e.offset] != '@') {
+                index.clear();
+                trusted = false;
+                break;
+            }
+            const std::string id = e.itemId;
+            index.emplace(id, std::move(e));
+        }
+    }
+    auto reusable = [&index](const std::pair<std::string, std::string> &v) {
+        auto f = index.find(v.first);
+        return f != index.end() && f->second.version == v.second;
+    };
+
+    size_t present = 0, current = 0;
+    for (const auto &v : versions) {
+        if (index.count(v.first)) ++present;
+        if (reusable(v)) ++current;
+    }
+    sync.removed = index.size() - present;
+    if (trusted && current == versions.size() && sync.removed == 0) {
+        sync.ok = true;
+        sync.copied = current;
+        return sync;
+    }
+
+    QSaveFile out(qpath);
+    if (!out.open(QIODevice::WriteOnly)) return sync;
+    const BibTeXExporter exporter(exp.keyPref);
+    QByteArray buffer;
+    buffer.reserve(kFlushBytes + 4096);
+    int64_t flushed = 0;
+    uint64_t hash = contentHash(nullptr, 0);
+    std::vector<LiveExportEntry> entries;
+    entries.reserve(versions.size());
+    for (size_t start = 0; start < versions.size(); start += kWindow) {
+        const size_t end = std::min(versions.size(), start + kWindow);
+        std::vector<std::string> ids;
+        for (size_t i = start; i < end; ++i) {
+            if (!reusable(versions[i])) ids.push_back(versions[i].first);
+        }
+        std::unordered_map<std::string, Item> items;
+        for (auto &it : db.getItems(ids)) items.emplace(it.id, std::move(it));
+
+        for (size_t i = start; i < end; ++i) {
+            const auto &v = versions[i];
+            auto prev = index.find(v.first);
+            const bool copy = prev != index.end() && prev->second.version == v.second;
+            auto item = copy ? items.end() : items.find(v.first);
+            if (!copy && item == items.end()) continue; // deleted meanwhile
+            if (!entries.empty()) buffer += "\n\n";
+            LiveExportEntry e;
+            e.itemId = v.first;
+            e.version = v.second;
+            e.offset = flushed + buffer.size();
+            if (copy) {
+                buffer.append(reinterpret_cast<const char*>(data) + prev->second.offset, prev->second.length);
+                ++sync.copied;
+            } else {
+                exporter.append(item->second, buffer);
+                ++sync.formatted;
+            }
+            e.length = flushed + buffer.size() - e.offset;
+            entries.push_back(std::move(e));
+            if (buffer.size() >= kFlushBytes) {
+                out.write(buffer);
+                hash = contentHash(buffer.constData(), buffer.size(), hash);
+                flushed += buffer.size();
+                buffer.truncate(0);
+            }
+        }
+    }
+    if (!entries.empty()) buffer += '\n';
+    out.write(buffer);
+    hash = contentHash(buffer.constData(), buffer.size(), hash);
+    flushed += buffer.size();
+
+    // The old file must be released before it is replaced (Windows cannot rename over a mapped file)
+    if (data) old.unmap(data);
+    old.close();
+    if (!out.commit()) return sync;
+    db.setLiveExportEntries(path, entries, flushed, hash);
+    sync.ok = true;
+    sync.rewritten = true;
+    return sync;
+}
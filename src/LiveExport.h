@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Database.h"
+#include <string>
+
+// Live exports: a collection bound to a .bib file that is kept current as items
+// change. The database keeps the byte range and version of every entry in the
+// file, and a hash of the whole file; a sync copies unchanged entries from the previous file as they are,
+// formats only new or changed items, drops removed ones and replaces the file
+// atomically (QSaveFile). A file edited by hand, or with an index that does not
+// match it, is regenerated in full. No QtWidgets dependency.
+
+struct LiveExportSync {
+    bool ok = false;           // false if the file could not be written
+    bool rewritten = false;    // false when the file was already current
+    size_t formatted = 0;      // entries written from the database
+    size_t copied = 0;         // entries copied from the previous file
+    size_t removed = 0;
+};
+
+// Bind `collection` to `path` (made absolute) and write it
+LiveExportSync startLiveExport(Database &db, const std::string &path, const std::string &collection, int keyPref);
+
+// Bring the file of the live export at `path` up to date
+LiveExportSync syncLiveExport(Database &db, const std::string &path);
@@ -10,6 +10,11 @@
 #include <QGroupBox>
 #include <QComboBox>
 #include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QHash>
+#include <QVector>
+#include <QLabel>
 #include <QPushButton>
 #include <QWidget>
 #include <QMimeData>
@@ -17,8 +22,18 @@
 #include <QMenu>
 #include <QToolButton>
 #include <QActionGroup>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
 #include "Database.h"
+#include "BibTeX.h"
+#include "Importers.h"
+#include "LinkedBib.h"
+#include "LiveExport.h"
+#include "Attachments.h"
+#include "StorageGC.h"
 #include "BrowserConnector.h"
 
 #include <QTcpServer>
@@ -63,9 +78,14 @@ public:
     void onItemSelected();
     void onCollectionCheckChanged(QListWidgetItem *changedItem);
     void onSaveItem();
+    void markFieldDirty(const QString &field);
+    void flushPendingEdits();
     void onOpenAttachment(QListWidgetItem *item);
     void onAttachmentContextMenuRequested(const QPoint &pos);
     void onRemoveAttachment();
+    // Open the attachments of `items`, skipping files the last scan found missing;
+    // returns how many were skipped
+    int openAttachments(const QList<QListWidgetItem*> &items);
     void onCollectionSelected();
     void onItemContextMenuRequested(const QPoint &pos);
     void onAdd();
@@ -74,25 +94,36 @@ public:
     void onRenameItem();
     void onDeleteItem();
     void copySelectedAsBibTeX();
+    void findDuplicates();
     void ensureShortcuts();
     void onCollectionContextMenuRequested(const QPoint &pos);
     void deleteCollection(const QString &name);
     void renameCollection(const QString &oldName);
     void exportCollection(const QString &name);
+    void keepExportedDialog(const QString &collection);
+    void stopLiveExport(const QString &path);
     void createCollection();
     void createSubcollection(const QString &parent);
     QString itemPath(QTreeWidgetItem* item) const;
     QStringList collectExpandedPaths() const;
     void restoreExpandedPaths(const QStringList &paths);
-    QTreeWidgetItem* ensureChild(QTreeWidgetItem* parent, const QString &name);
+    void rebuildCollectionTree(const QStringList &expanded, const QString &selectedPath);
+    void populateCollectionChildren(QTreeWidgetItem *node);
+    QTreeWidgetItem *collectionNode(const QString &path);
+    // Set on collection tree nodes whose children have been created
+    static constexpr int CollectionLoadedRole = Qt::UserRole + 1;
     void importToCollection(const QString &name);
     void importItemsDialog(const QString &targetCollection);
-    int importBibTeX(const QString &path, const QString &collection);
-    int importZoteroRDF(const QString &path, const QString &collection);
-    int importEndNoteXML(const QString &path, const QString &collection);
-    int importMendeleyXML(const QString &path, const QString &collection);
+    ImportStats importBibTeX(const QString &path, const QString &collection, bool merge);
+    ImportStats importZoteroRDF(const QString &path, const QString &collection, bool merge);
+    ImportStats importEndNoteXML(const QString &path, const QString &collection, bool merge);
+    ImportStats importMendeleyXML(const QString &path, const QString &collection, bool merge);
+    void linkBibFileDialog(const QString &collection);
+    void unlinkBibFile(const QString &path);
     QString formatCitation(const Item &it);
     QString itemToBibTeX(const Item &it);
+    // Formats BibTeX with the "export/bibkey" preference, updated when the menu changes it
+    BibTeXExporter bibtex;
 
     struct UI {
         QTreeWidget *collectionsList = nullptr;
@@ -112,6 +143,22 @@ public:
         QFormLayout *dynamicFieldsLayout = nullptr;
         int dynamicInsertIndex = 0;
         QMap<QString, QWidget*> dynamicFieldEdits;
+        // Collection path -> tree node ("" is All Items) for the nodes loaded so far
+        QHash<QString, QTreeWidgetItem*> collectionNodes;
+        // Children per collection path, valid while collectionsRevision() is unchanged
+        QHash<QString, std::vector<CollectionNode>> collectionChildCache;
+        uint64_t collectionChildCacheRevision = 0;
+        // collectionsRevision() the check list was built at; none yet
+        uint64_t collectionCheckListRevision = UINT64_MAX;
+        // Prebuilt label/editor rows, one pool per entry-type field list (see populateDynamicFields)
+        struct DynamicFieldRow {
+            QString field;
+            QLabel *label = nullptr;
+            QWidget *editor = nullptr;
+            QFormLayout *layout = nullptr; // layout currently holding the row, null while pooled
+        };
+        QHash<QString, QVector<DynamicFieldRow>> dynamicFieldPools;
+        QString dynamicPoolKey;
         QPushButton *addBtn = nullptr;
     } *ui = nullptr;
 
@@ -120,12 +167,45 @@ private:
     QTcpServer *connectorServer = nullptr;
     BrowserConnector *browserConnector = nullptr;
     void startConnectorServer();
+    // Deferred autosave: edited field names for dirtyItemId, written when autosaveTimer fires
+    QTimer *autosaveTimer = nullptr;
+    QSet<QString> dirtyFields;
+    QString dirtyItemId;
+    // Linked .bib files: change notifications are collected in pendingBibSyncs and
+    // synced once bibSyncTimer fires, as editors often write a file in several steps
+    QFileSystemWatcher *bibWatcher = nullptr;
+    QTimer *bibSyncTimer = nullptr;
+    QSet<QString> pendingBibSyncs;
+    void watchLinkedBibs();
+    void syncPendingBibs();
+    // Live exports are brought up to date when liveExportTimer fires, which the first
+    // item change after a sync starts
+    QTimer *liveExportTimer = nullptr;
+    void syncLiveExports();
+    // Attachment status (see Attachments.h): attachmentScanTimer scans one batch of files
+    // at a time on attachmentScanThread. attachmentWatcher marks directories for rescanning.
+    QFileSystemWatcher *attachmentWatcher = nullptr;
+    QTimer *attachmentScanTimer = nullptr;
+    QThread *attachmentScanThread = nullptr;
+    bool attachmentsChanged = true;
+    void scanAttachments();
+    void watchAttachmentDirs();
+    // Show `status` (null if not scanned yet) on an attachments list row
+    void showAttachmentStatus(QListWidgetItem *row, const Attachment *status);
+    // Storage garbage collection (see StorageGC.h): storageGcTimer runs one step of a
+    // pass at a time on storageGcThread. Orphans are deleted only with "storage/reclaim" set.
+    StorageCollector storageCollector;
+    QTimer *storageGcTimer = nullptr;
+    QThread *storageGcThread = nullptr;
+    StorageReclaimed storageGcFound;    // orphans found in the current pass
+    void collectStorage();
 };
 
 #include "Helpers.h"
 #include "LeftSection.h"
 #include "CenterSection.h"
 #include "RightSection.h"
+#include "DuplicatesView.h"
 
 #include "EventHandlers.h"
 #include "UI.h"
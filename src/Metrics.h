@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fixed-bucket histogram that any thread can update without locks. Buckets hold
+// per-bucket counts; render() turns them into cumulative Prometheus buckets.
+class Histogram {
+public:
+    // `scale` converts observations into the integer units used for the running sum
+    // (1e6 keeps microsecond precision for seconds, 1 for byte counts).
+    Histogram(std::string name, std::string help, std::vector<double> bounds, double scale = 1e6)
+        : name(std::move(name)), help(std::move(help)), bounds(std::move(bounds)), scale(scale),
+          buckets(new std::atomic<uint64_t>[this->bounds.size() + 1]) {
+        for (size_t i = 0; i <= this->bounds.size(); ++i) buckets[i].store(0, std::memory_order_relaxed);
+    }
+
+    void observe(double v) {
+        size_t i = std::lower_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumScaled.fetch_add((uint64_t)(std::max(0.0, v) * scale), std::memory_order_relaxed);
+    }
+
+    void render(std::string &out) const {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            cumulative += buckets[i].load(std::memory_order_relaxed);
+            out += name + "_bucket{le=\"" + formatNumber(bounds[i]) + "\"} " + std::to_string(cumulative) + "\n";
+        }
+        cumulative += buckets[bounds.size()].load(std::memory_order_relaxed);
+        out += name + "_bucket{le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+        out += name + "_sum " + formatNumber(sumScaled.load(std::memory_order_relaxed) / scale) + "\n";
+        out += name + "_count " + std::to_string(count.load(std::memory_order_relaxed)) + "\n";
+    }
+
+    static std::vector<double> secondsBuckets() {
+        return {0.0001, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    }
+    static std::vector<double> bytesBuckets() {
+        return {1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216, 67108864, 268435456};
+    }
+
+private:
+    std::string name;
+    std::string help;
+    std::vector<double> bounds;
+    double scale;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumScaled{0};
+
+    static std::string formatNumber(double v) {
+        std::string s = std::to_string(v);
+        s.erase(s.find_last_not_of('0') + 1);
+        if (!s.empty() && s.back() == '.') s.pop_back();
+        return s;
+    }
+};
+
+// Records the lifetime of the enclosing scope into a seconds histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram &h) : h(h), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { h.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer &operator=(const ScopedTimer&) = delete;
+private:
+    Histogram &h;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Per-request instrumentation for the browser connector, exposed at /connector/metrics
+struct ConnectorMetrics {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> notFound{0};
+    Histogram requestBytes{"bello_connector_request_bytes", "Bytes received per request (headers and body).", Histogram::bytesBuckets(), 1};
+    Histogram requestSeconds{"bello_connector_request_seconds", "Time from complete request to response written.", Histogram::secondsBuckets()};
+    Histogram parseSeconds{"bello_connector_parse_seconds", "JSON parse time of request bodies.", Histogram::secondsBuckets()};
+    Histogram base64Seconds{"bello_connector_base64_decode_seconds", "Base64 decode time of embedded attachments.", Histogram::secondsBuckets()};
+    Histogram dedupeSeconds{"bello_connector_dedupe_seconds", "Time spent matching incoming entries against the library.", Histogram::secondsBuckets()};
+    Histogram dbWriteSeconds{"bello_connector_db_write_seconds", "Time spent inserting or updating items.", Histogram::secondsBuckets()};
+    Histogram diskWriteSeconds{"bello_connector_disk_write_seconds", "Time spent writing attachment files.", Histogram::secondsBuckets()};
+    Histogram uiRefreshSeconds{"bello_connector_ui_refresh_seconds", "Time spent refreshing the main window after a save.", Histogram::secondsBuckets()};
+
+    std::string render() const {
+        std::string out;
+        out += "# HELP bello_connector_requests_total Requests handled by the connector.\n";
+        out += "# TYPE bello_connector_requests_total counter\n";
+        out += "bello_connector_requests_total " + std::to_string(requests.load(std::memory_order_relaxed)) + "\n";
+        out += "# HELP bello_connector_not_found_total Requests for unknown endpoints.\n";
+        out += "# TYPE bello_connector_not_found_total counter\n";
+        out += "bello_connector_not_found_total " + std::to_string(notFound.load(std::memory_order_relaxed)) + "\n";
+        for (const Histogram *h : {&requestBytes, &requestSeconds, &parseSeconds, &base64Seconds, &dedupeSeconds,
+                                   &dbWriteSeconds, &diskWriteSeconds, &uiRefreshSeconds}) {
+            h->render(out);
+        }
+        return out;
+    }
+};
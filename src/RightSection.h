@@ -7,6 +7,8 @@
 #include <QJsonObject>
 #include <QSet>
 #include <QFileIconProvider>
+#include <QMimeDatabase>
+#include <memory>
 #include <QListWidgetItem>
 #include <QMenu>
 #include <QMessageBox>
@@ -21,6 +23,8 @@ class MainWindow;
 #include <QLabel>
 
 inline void MainWindow::onItemSelected() {
+    // Write edits made to the previously shown item before the form is refilled
+    flushPendingEdits();
     auto selectedItems = ui->itemsList->selectedItems();
     
     // Block signals during programmatic updates to avoid triggering auto-save
@@ -100,21 +104,15 @@ inline void MainWindow::onItemSelected() {
             }
         }
 
-        // Populate attachments list from item's pdf_path (semicolon-separated)
+        // Populate attachments list, marked with the cached scan status rather than by
+        // checking the files here
         ui->attachmentsList->clear();
-        if (!item.pdf_path.empty()) {
-            QStringList parts = QString::fromStdString(item.pdf_path).split(';', Qt::SkipEmptyParts);
-            QFileIconProvider provider;
-            for (const QString &p : parts) {
-                QString trimmed = p.trimmed();
-                if (trimmed.isEmpty()) continue;
-                QFileInfo fi(trimmed);
-                QListWidgetItem *ait = new QListWidgetItem(fi.fileName());
-                ait->setData(Qt::UserRole, trimmed);
-                ait->setToolTip(trimmed);
-                ait->setIcon(provider.icon(fi));
-                ui->attachmentsList->addItem(ait);
-            }
+        for (const auto &a : db->getAttachments({itemId})) {
+            const QString path = QString::fromStdString(a.path);
+            QListWidgetItem *ait = new QListWidgetItem(QFileInfo(path).fileName());
+            ait->setData(Qt::UserRole, path);
+            showAttachmentStatus(ait, a.scanned ? &a : nullptr);
+            ui->attachmentsList->addItem(ait);
         }
         if (ui->attachmentsList->count() == 0) {
             QListWidgetItem *ph = new QListWidgetItem("Drag files here or click to add");
@@ -249,69 +247,17 @@ inline void MainWindow::onSaveItem() {
     }
     
     if (selectedItems.size() == 1) {
-        // Single item - update all fields
-        auto *it = selectedItems.first();
-        Item item;
-        if (!db->getItem(it->data(Qt::UserRole).toString().toStdString(), item)) return;
-
-        item.title = ui->title->text().toStdString();
-        item.authors = ui->authors->text().toStdString();
-        item.year = ui->year->text().toStdString();
-        item.isbn = ui->isbn->text().toStdString();
-        item.doi = ui->doi->text().toStdString();
-        item.type = ui->entryType->currentText().toStdString();
-        // Serialize dynamic fields (QLineEdit or QTextEdit) into JSON and persist to item.extra
-        QJsonObject extraObj;
-        for (auto iter = ui->dynamicFieldEdits.begin(); iter != ui->dynamicFieldEdits.end(); ++iter) {
-            QString key = iter.key();
-            QWidget *w = iter.value();
-            if (!w) continue;
-            QString v;
-            if (auto le = qobject_cast<QLineEdit*>(w)) {
-                v = le->text().trimmed();
-            } else if (auto te = qobject_cast<QTextEdit*>(w)) {
-                v = te->toPlainText().trimmed();
-            }
-            if (v.isEmpty()) continue;
-
-            // Map common structured fields back to Item members, otherwise put into extra JSON
-            if (key == "publisher") item.publisher = v.toStdString();
-            else if (key == "editor") item.editor = v.toStdString();
-            else if (key == "booktitle") item.booktitle = v.toStdString();
-            else if (key == "series") item.series = v.toStdString();
-            else if (key == "edition") item.edition = v.toStdString();
-            else if (key == "chapter") item.chapter = v.toStdString();
-            else if (key == "school") item.school = v.toStdString();
-            else if (key == "institution") item.institution = v.toStdString();
-            else if (key == "organization") item.organization = v.toStdString();
-            else if (key == "howpublished") item.howpublished = v.toStdString();
-            else if (key == "language") item.language = v.toStdString();
-            else if (key == "journal") item.journal = v.toStdString();
-            else if (key == "pages") item.pages = v.toStdString();
-            else if (key == "volume") item.volume = v.toStdString();
-            else if (key == "number") item.number = v.toStdString();
-            else if (key == "keywords") item.keywords = v.toStdString();
-            else if (key == "month") item.month = v.toStdString();
-            else if (key == "address") item.address = v.toStdString();
-            else if (key == "note") item.note = v.toStdString();
-            else extraObj.insert(key, QJsonValue(v));
+        // Single item - write whatever has been edited since the last save, and the checked collection
+        flushPendingEdits();
+        const std::string id = selectedItems.first()->data(Qt::UserRole).toString().toStdString();
+        std::string current;
+        if (db->getItemField(id, "collection", current) && current != targetCollection.toStdString()) {
+            db->patchItem(id, {{"collection", targetCollection.toStdString()}});
         }
-        QJsonDocument doc(extraObj);
-        item.extra = doc.toJson(QJsonDocument::Compact).toStdString();
-        item.collection = targetCollection.toStdString();
-
-        db->updateItem(item);
-        // Refresh right panel in-place without full reload to preserve selection and focus
-        onItemSelected();
-        // Done for single-item case
     } else {
         // Multiple items - only update collection membership
         for (auto *listItem : selectedItems) {
-            Item item;
-            if (db->getItem(listItem->data(Qt::UserRole).toString().toStdString(), item)) {
-                item.collection = targetCollection.toStdString();
-                db->updateItem(item);
-            }
+            db->patchItem(listItem->data(Qt::UserRole).toString().toStdString(), {{"collection", targetCollection.toStdString()}});
         }
         // For multi-select updates, refresh the list since items may move
         reload();
@@ -321,8 +267,9 @@ inline void MainWindow::onSaveItem() {
 inline void MainWindow::onOpenAttachment(QListWidgetItem *item) {
     if (!item) return;
     QString path = item->data(Qt::UserRole).toString();
-    if (path.isEmpty()) return;
-    if (!QFile::exists(path)) {
+    if (path.isEmpty() || path == "__placeholder") return;
+    // Set by showAttachmentStatus when the last scan did not find the file
+    if (item->data(Qt::UserRole + 1).toBool()) {
         QMessageBox::warning(this, "Open Attachment", QString("File does not exist: %1").arg(path));
         return;
     }
@@ -354,9 +301,9 @@ inline void MainWindow::onRemoveAttachment() {
     // Confirm removal of reference
     if (QMessageBox::question(this, "Remove Attachment", QString("Remove attachment reference '%1' from this item?").arg(path)) != QMessageBox::Yes) return;
 
-    // Ask if they want to delete the file from disk
+    // Ask if they want to delete the file from disk, unless the last scan found it missing
     bool deleteFile = false;
-    if (QFile::exists(path)) {
+    if (!ait->data(Qt::UserRole + 1).toBool()) {
         auto resp = QMessageBox::question(this, "Delete File", "Also delete the file from disk?", QMessageBox::Yes | QMessageBox::No);
         deleteFile = (resp == QMessageBox::Yes);
     }
@@ -364,16 +311,7 @@ inline void MainWindow::onRemoveAttachment() {
     // Update DB for the first selected item (for multi-select we'd update each, but this is per-item action)
     auto sel = selectedItems.first();
     std::string itemId = sel->data(Qt::UserRole).toString().toStdString();
-    Item item;
-    if (!db->getItem(itemId, item)) return;
-
-    QStringList parts = QString::fromStdString(item.pdf_path).split(';', Qt::SkipEmptyParts);
-    QStringList keep;
-    for (const QString &p : parts) {
-        if (p.trimmed() != path) keep << p.trimmed();
-    }
-    item.pdf_path = keep.join(';').toStdString();
-    db->updateItem(item);
+    db->removeAttachments({{itemId, path.toStdString()}});
 
     if (deleteFile) {
         try { std::filesystem::remove(path.toStdString()); } catch(...) {}
@@ -382,3 +320,173 @@ inline void MainWindow::onRemoveAttachment() {
     // Refresh right pane without losing selection
     onItemSelected();
 }
+
+inline void MainWindow::markFieldDirty(const QString &field) {
+    auto selectedItems = ui->itemsList->selectedItems();
+    if (selectedItems.size() != 1) return;
+    QString id = selectedItems.first()->data(Qt::UserRole).toString();
+    if (!dirtyItemId.isEmpty() && dirtyItemId != id) flushPendingEdits();
+    dirtyItemId = id;
+    dirtyFields.insert(field);
+    autosaveTimer->start(); // restart: the write happens once typing pauses
+}
+
+// Write the dirty fields of dirtyItemId as a single column-level patch
+inline void MainWindow::flushPendingEdits() {
+    if (autosaveTimer) autosaveTimer->stop();
+    if (dirtyFields.isEmpty() || dirtyItemId.isEmpty()) return;
+    const QSet<QString> fields = dirtyFields;
+    const std::string id = dirtyItemId.toStdString();
+    dirtyFields.clear();
+    dirtyItemId.clear();
+
+    // Dynamic fields stored in their own column; everything else lives in the extra JSON
+    static const QSet<QString> columnFields = {
+        "publisher","editor","booktitle","series","edition","chapter","school","institution","organization",
+        "howpublished","language","journal","pages","volume","number","keywords","month","address","note"
+    };
+    auto editorText = [](QWidget *w) {
+        if (auto le = qobject_cast<QLineEdit*>(w)) return le->text().trimmed();
+        if (auto te = qobject_cast<QTextEdit*>(w)) return te->toPlainText().trimmed();
+        return QString();
+    };
+
+    std::map<std::string, std::string> patch;
+    QMap<QString, QString> extraEdits;
+    for (const QString &f : fields) {
+        if (f == "title") patch["title"] = ui->title->text().toStdString();
+        else if (f == "authors") patch["authors"] = ui->authors->text().toStdString();
+        else if (f == "year") patch["year"] = ui->year->text().toStdString();
+        else if (f == "isbn") patch["isbn"] = ui->isbn->text().toStdString();
+        else if (f == "doi") patch["doi"] = ui->doi->text().toStdString();
+        else if (f == "type") patch["type"] = ui->entryType->currentText().toStdString();
+        else if (QWidget *w = ui->dynamicFieldEdits.value(f)) {
+            if (columnFields.contains(f.toLower())) patch[f.toLower().toStdString()] = editorText(w).toStdString();
+            else extraEdits.insert(f, editorText(w));
+        }
+    }
+    if (!extraEdits.isEmpty()) {
+        Item item;
+        if (db->getItem(id, item)) {
+            QJsonObject extraObj = QJsonDocument::fromJson(QByteArray::fromStdString(item.extra)).object();
+            for (auto e = extraEdits.begin(); e != extraEdits.end(); ++e) {
+                for (const QString &k : extraObj.keys()) {
+                    if (k.compare(e.key(), Qt::CaseInsensitive) == 0) extraObj.remove(k);
+                }
+                if (!e.value().isEmpty()) extraObj.insert(e.key(), e.value());
+            }
+            patch["extra"] = QJsonDocument(extraObj).toJson(QJsonDocument::Compact).toStdString();
+        }
+    }
+    db->patchItem(id, patch);
+}
+
+inline void MainWindow::showAttachmentStatus(QListWidgetItem *row, const Attachment *status) {
+    const QString path = row->data(Qt::UserRole).toString();
+    const bool missing = status && status->scanned && !status->present;
+    row->setData(Qt::UserRole + 1, missing);
+    row->setForeground(missing ? QBrush(Qt::gray) : QBrush());
+    row->setToolTip(missing ? path + " (missing)" : path);
+    // Icon from the file name alone, which needs no file access
+    const QMimeType mime = QMimeDatabase().mimeTypeForFile(path, QMimeDatabase::MatchExtension);
+    row->setIcon(QIcon::fromTheme(mime.iconName(), QIcon::fromTheme(mime.genericIconName(),
+                                  QFileIconProvider().icon(QFileIconProvider::File))));
+}
+
+// One background scan step: stat (and hash, when changed) a batch of due files on a
+// low-priority thread. Each stored batch schedules the next step; with nothing due the
+// timer idles for ten minutes.
+inline void MainWindow::scanAttachments() {
+    if (attachmentScanThread) return; // the running batch reschedules when it finishes
+    if (attachmentsChanged) {
+        attachmentsChanged = false;
+        watchAttachmentDirs();
+    }
+    std::vector<Attachment> batch = db->listAttachmentsToScan(32, 24 * 3600);
+    if (batch.empty()) {
+        attachmentScanTimer->start(10 * 60 * 1000);
+        return;
+    }
+    auto results = std::make_shared<std::vector<Attachment>>();
+    attachmentScanThread = QThread::create([batch = std::move(batch), results]() {
+        for (const auto &a : batch) {
+            if (QThread::currentThread()->isInterruptionRequested()) break;
+            results->push_back(scanAttachment(a));
+        }
+    });
+    connect(attachmentScanThread, &QThread::finished, this, [this, results]() {
+        attachmentScanThread->deleteLater();
+        attachmentScanThread = nullptr;
+        db->setAttachmentStatus(*results);
+        // Refresh the rows of the item on display in place
+        QHash<QString, const Attachment*> byPath;
+        for (const auto &a : *results) byPath.insert(QString::fromStdString(a.path), &a);
+        for (int i = 0; i < ui->attachmentsList->count(); ++i) {
+            auto *row = ui->attachmentsList->item(i);
+            if (const Attachment *st = byPath.value(row->data(Qt::UserRole).toString())) showAttachmentStatus(row, st);
+        }
+        attachmentScanTimer->start(250);
+    });
+    attachmentScanThread->start(QThread::LowestPriority);
+}
+
+// One storage garbage collection step: walk a bounded number of entries on a
+// low-priority thread, then, when enabled, delete the confirmed orphans on another.
+// Steps follow each other every two seconds until the pass is done; the next pass
+// starts an hour later.
+inline void MainWindow::collectStorage() {
+    if (storageGcThread) return; // the running step reschedules when it finishes
+    storageCollector.prepare(*db);
+    storageGcThread = QThread::create([this]() { storageCollector.walk(2000, 2); });
+    connect(storageGcThread, &QThread::finished, this, [this]() {
+        storageGcThread->deleteLater();
+        storageGcThread = nullptr;
+        std::vector<StorageOrphan> orphans = storageCollector.confirm(*db);
+        for (const auto &o : orphans) {
+            if (o.directory) ++storageGcFound.directories;
+            else { ++storageGcFound.files; storageGcFound.bytes += o.size; }
+        }
+        const bool reclaim = QSettings("bello", "bello").value("storage/reclaim", false).toBool();
+        auto next = [this, reclaim]() {
+            if (!storageCollector.passDone()) {
+                storageGcTimer->start(2000);
+                return;
+            }
+            if (storageGcFound.files || storageGcFound.directories) {
+                qInfo("Storage: %zu orphaned files (%llu bytes) and %zu empty directories%s", storageGcFound.files,
+                      (unsigned long long)storageGcFound.bytes, storageGcFound.directories, reclaim ? ", removed" : "");
+            }
+            storageGcFound = StorageReclaimed();
+            storageGcTimer->start(60 * 60 * 1000);
+        };
+        if (orphans.empty() || !reclaim) {
+            next();
+            return;
+        }
+        storageGcThread = QThread::create([orphans = std::move(orphans)]() { StorageCollector::reclaim(orphans); });
+        connect(storageGcThread, &QThread::finished, this, [this, next]() {
+            storageGcThread->deleteLater();
+            storageGcThread = nullptr;
+            next();
+        });
+        storageGcThread->start(QThread::LowestPriority);
+    });
+    storageGcThread->start(QThread::LowestPriority);
+}
+
+// Watch the directories holding the most attachments; the rest are only rescanned
+// periodically, which keeps the number of inotify watches bounded
+inline void MainWindow::watchAttachmentDirs() {
+    QStringList dirs;
+    for (const auto &d : db->listAttachmentDirs(256)) dirs << QString::fromStdString(d);
+    const QStringList watched = attachmentWatcher->directories();
+    QStringList stale, added;
+    for (const QString &d : watched) {
+        if (!dirs.contains(d)) stale << d;
+    }
+    for (const QString &d : dirs) {
+        if (!watched.contains(d)) added << d;
+    }
+    if (!stale.isEmpty()) attachmentWatcher->removePaths(stale);
+    if (!added.isEmpty()) attachmentWatcher->addPaths(added);
+}
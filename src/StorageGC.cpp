@@ -0,0 +1,154 @@
+#include "StorageGC.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const auto kGracePeriod = std::chrono::hours(1);
+
+bool isRecent(const fs::path &p, fs::file_time_type cutoff) {
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(p, ec);
+    return ec || mtime > cutoff;
+}
+
+} // namespace
+
+std::string attachmentStorageDir() {
+    const char *home = std::getenv("HOME");
+    return (fs::path(home ? home : "") / ".local" / "share" / "bello" / "storage").string();
+}
+
+bool inAttachmentStorage(const std::string &path) {
+    const fs::path p = fs::path(path).lexically_normal();
+    if (!p.is_absolute()) return false;
+    const fs::path rel = p.lexically_relative(fs::path(attachmentStorageDir()).lexically_normal());
+    return !rel.empty() && *rel.begin() != ".." && rel != ".";
+}
+
+StorageCollector::StorageCollector(std::string root) : root(std::move(root)) {}
+
+void StorageCollector::prepare(Database &db) {
+    if (active && !passDone()) return;
+    referenced.clear();
+    for (const auto &p : db.listAttachmentPaths()) referenced.insert(fs::path(p).lexically_normal().string());
+    std::error_code ec;
+    rootIt = fs::directory_iterator(root, ec);
+    if (ec) rootIt = fs::directory_iterator();
+    stacks.clear();
+    visitedEntries = 0;
+    active = true;
+}
+
+bool StorageCollector::passDone() const {
+    if (!active || rootIt != fs::directory_iterator()) return false;
+    return std::all_of(stacks.begin(), stacks.end(), [](const std::vector<Frame> &s) { return s.empty(); });
+}
+
+void StorageCollector::walk(size_t budget, unsigned threads) {
+    if (!active) return;
+    if (stacks.size() < std::max(1u, threads)) stacks.resize(std::max(1u, threads));
+    stepVisited = 0;
+    const fs::file_time_type cutoff = fs::file_time_type::clock::now() - kGracePeriod;
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < stacks.size(); ++t) pool.emplace_back([this, t, budget, cutoff]() { walkFrom(stacks[t], budget, cutoff); });
+    walkFrom(stacks[0], budget, cutoff);
+    for (auto &t : pool) t.join();
+    visitedEntries += stepVisited;
+}
+
+// Take entries from the directory on top of `stack`, or from the root when the stack is
+// empty, until the step's budget is spent. A file is an orphan when nothing refers to
+// it; a directory when, once all its entries were seen, they all were orphans.
+void StorageCollector::walkFrom(std::vector<Frame> &stack, size_t budget, fs::file_time_type cutoff) {
+    std::vector<StorageOrphan> out;
+    const fs::directory_iterator end;
+    while (stepVisited < budget) {
+        std::error_code ec;
+        fs::path p;
+        if (stack.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (rootIt == end) break;
+            p = rootIt->path();
+            rootIt.increment(ec);
+            if (ec) rootIt = end;
+        } else if (stack.back().it == end) {
+            Frame done = std::move(stack.back());
+            stack.pop_back();
+            const bool orphan = done.orphan && !isRecent(done.dir, cutoff);
+            if (orphan) out.push_back({done.dir.string(), true, 0});
+            else if (!stack.empty()) stack.back().orphan = false;
+            continue;
+        } else {
+            Frame &f = stack.back();
+            p = f.it->path();
+            f.it.increment(ec);
+            // An unreadable directory is kept
+            if (ec) { f.orphan = false; f.it = end; }
+        }
+        ++stepVisited;
+
+        bool orphan = false;
+        const fs::file_status status = fs::symlink_status(p, ec);
+        if (!ec && fs::is_directory(status)) {
+            fs::directory_iterator it(p, ec);
+            if (!ec) {
+                stack.push_back({p, std::move(it), true});
+                continue; // judged once its entries are seen
+            }
+        } else if (!ec && fs::is_regular_file(status) && !isRecent(p, cutoff)
+                   && !referenced.count(p.lexically_normal().string())) {
+            // Symlinks and special files are left alone
+            const uintmax_t size = fs::file_size(p, ec);
+            out.push_back({p.string(), false, ec ? 0 : uint64_t(size)});
+            orphan = true;
+        }
+        if (!orphan && !stack.empty()) stack.back().orphan = false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    found.insert(found.end(), std::make_move_iterator(out.begin()), std::make_move_iterator(out.end()));
+}
+
+std::vector<StorageOrphan> StorageCollector::confirm(Database &db) {
+    std::vector<StorageOrphan> orphans = std::move(found);
+    found.clear();
+    if (orphans.empty()) return orphans;
+    // Files attached since prepare() are no longer orphans, and neither are their directories
+    std::vector<std::string> attached;
+    for (const auto &p : db.listAttachmentPaths()) {
+        std::string n = fs::path(p).lexically_normal().string();
+        if (!referenced.count(n)) attached.push_back(std::move(n));
+    }
+    if (attached.empty()) return orphans;
+    const std::unordered_set<std::string> now(attached.begin(), attached.end());
+    orphans.erase(std::remove_if(orphans.begin(), orphans.end(), [&](const StorageOrphan &o) {
+        const std::string n = fs::path(o.path).lexically_normal().string();
+        if (!o.directory) return now.count(n) > 0;
+        const std::string prefix = n + std::string(1, fs::path::preferred_separator);
+        return std::any_of(attached.begin(), attached.end(), [&](const std::string &a) { return a.compare(0, prefix.size(), prefix) == 0; });
+    }), orphans.end());
+    return orphans;
+}
+
+StorageReclaimed StorageCollector::reclaim(const std::vector<StorageOrphan> &orphans) {
+    StorageReclaimed r;
+    for (const auto &o : orphans) {
+        std::error_code ec;
+        // remove() fails on a directory that is not empty, e.g. one a file was saved to meanwhile
+        if (!fs::remove(o.path, ec) || ec) continue;
+        if (o.directory) {
+            ++r.directories;
+        } else {
+            ++r.files;
+            r.bytes += o.size;
+        }
+    }
+    return r;
+}
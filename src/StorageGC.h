@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Database.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Garbage collection of the attachment storage (~/.local/share/bello/storage), where
+// uploads, imports and the browser connector copy files. A file no attachment refers
+// to is an orphan, and so is a directory holding nothing but orphans.
+//
+// A pass walks the storage in steps of a bounded number of directory entries, each
+// spread over a few threads, so it can run in the background. Each thread keeps its
+// place (a stack of open directories) between steps, so a step never lists a whole
+// directory or walks a whole subtree at once. The database is read only by prepare()
+// and confirm(), on the thread that owns it; walk() and reclaim() touch only the
+// filesystem. Anything modified in the last hour is kept, since it may belong to an
+// item still being saved. No Qt dependency.
+
+// The storage directory
+std::string attachmentStorageDir();
+
+// Whether `path` lies inside the storage directory (lexically, symlinks are not resolved)
+bool inAttachmentStorage(const std::string &path);
+
+struct StorageOrphan {
+    std::string path;
+    bool directory = false;
+    uint64_t size = 0;         // bytes, 0 for directories
+};
+
+struct StorageReclaimed {
+    size_t files = 0;
+    size_t directories = 0;
+    uint64_t bytes = 0;
+};
+
+class StorageCollector {
+public:
+    explicit StorageCollector(std::string root = attachmentStorageDir());
+
+    // Start a pass, unless one is under way, from a snapshot of the referenced paths
+    void prepare(Database &db);
+    // Continue the pass over `budget` more entries (a few more when threads race) using
+    // `threads` threads, or as many as an earlier step used if that was more
+    void walk(size_t budget, unsigned threads);
+    // The orphans found since the last confirm that are still unreferenced, each
+    // directory after its contents
+    std::vector<StorageOrphan> confirm(Database &db);
+    // Delete `orphans`; a directory only if it is empty by then
+    static StorageReclaimed reclaim(const std::vector<StorageOrphan> &orphans);
+
+    // True once the pass visited every entry; the next prepare starts a new one
+    bool passDone() const;
+    // Entries visited in the current pass
+    size_t visited() const { return visitedEntries; }
+
+private:
+    // A directory being walked: its remaining entries, and whether all entries so far were orphans
+    struct Frame {
+        std::filesystem::path dir;
+        std::filesystem::directory_iterator it;
+        bool orphan = true;
+    };
+    void walkFrom(std::vector<Frame> &stack, size_t budget, std::filesystem::file_time_type cutoff);
+
+    std::string root;
+    std::unordered_set<std::string> referenced;   // normalized attachment paths
+    std::filesystem::directory_iterator rootIt;   // top-level entries no thread claimed yet
+    std::vector<std::vector<Frame>> stacks;       // one per thread, kept between steps
+    bool active = false;
+    size_t visitedEntries = 0;
+    std::vector<StorageOrphan> found;
+    // Shared by the threads of a step
+    std::mutex mutex;                             // guards rootIt and found
+    std::atomic<size_t> stepVisited{0};
+};
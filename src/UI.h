@@ -44,10 +44,10 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
     searchRowLayout->setContentsMargins(0,0,0,0);
     searchRowLayout->addWidget(ui->search, 1);
 
-    // gear button to configure BibTeX export key preference
+    // gear button: BibTeX export key preference and storage cleanup
     QToolButton *bibSettingsBtn = new QToolButton();
     bibSettingsBtn->setText("⚙");
-    bibSettingsBtn->setToolTip("BibTeX export key settings");
+    bibSettingsBtn->setToolTip("Settings");
     QMenu *bibMenu = new QMenu(bibSettingsBtn);
     // explanatory section title
     bibMenu->addSection("BibTeX export identifier:");
@@ -60,6 +60,9 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
     bibGroup->setExclusive(true);
     bibGroup->addAction(opt1);
     bibGroup->addAction(opt2);
+    bibMenu->addSection("Attachment storage:");
+    QAction *reclaimOpt = bibMenu->addAction("Delete unreferenced files");
+    reclaimOpt->setCheckable(true);
     bibSettingsBtn->setMenu(bibMenu);
     bibSettingsBtn->setPopupMode(QToolButton::InstantPopup);
     searchRowLayout->addWidget(bibSettingsBtn);
@@ -147,14 +150,9 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
         auto selectedItems = ui->itemsList->selectedItems();
         if (selectedItems.isEmpty()) return;
         std::string itemId = selectedItems.first()->data(Qt::UserRole).toString().toStdString();
-        Item dbItem;
-        if (!db->getItem(itemId, dbItem)) return;
-        QStringList existing = QString::fromStdString(dbItem.pdf_path).split(';', Qt::SkipEmptyParts);
-        for (const QString &f : files) {
-            if (!existing.contains(f)) existing << f;
-        }
-        dbItem.pdf_path = existing.join(';').toStdString();
-        db->updateItem(dbItem);
+        std::vector<std::pair<std::string, std::string>> added;
+        for (const QString &f : files) added.emplace_back(itemId, f.toStdString());
+        db->addAttachments(added);
         onItemSelected();
     });
     connect(ui->itemsList, &QListWidget::itemDoubleClicked, this, &MainWindow::onOpenItem);
@@ -163,6 +161,7 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
     connect(ui->itemsList, &QListWidget::itemClicked, this, &MainWindow::onItemSelected);
     connect(ui->itemsList, &QListWidget::itemSelectionChanged, this, &MainWindow::onItemSelected);
     connect(ui->collectionsList, &QTreeWidget::itemClicked, this, &MainWindow::onCollectionSelected);
+    connect(ui->collectionsList, &QTreeWidget::itemExpanded, this, &MainWindow::populateCollectionChildren);
 
     // Search filtering: show matching items when there's text, otherwise show current collection
     connect(ui->search, &QLineEdit::textChanged, [this](const QString &text){
@@ -174,44 +173,120 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
             return;
         }
 
-        auto items = db->listItems();
-        for (const auto &it : items) {
-            QString title = QString::fromStdString(it.title);
-            QString authors = QString::fromStdString(it.authors);
-            QString doi = QString::fromStdString(it.doi);
-            QString isbn = QString::fromStdString(it.isbn);
-            if (title.contains(q, Qt::CaseInsensitive) || authors.contains(q, Qt::CaseInsensitive)
-                || doi.contains(q, Qt::CaseInsensitive) || isbn.contains(q, Qt::CaseInsensitive)) {
-                auto *listItem = new QListWidgetItem(title);
+        // Filtering runs in SQL (case-insensitive match on title, authors, DOI or ISBN)
+        ItemQuery query;
+        query.limit = 0;
+        query.search = q.toStdString();
+        db->queryItems(query, [this](const std::vector<Item> &items) {
+            for (const auto &it : items) {
+                auto *listItem = new QListWidgetItem(QString::fromStdString(it.title));
                 listItem->setData(Qt::UserRole, QString::fromStdString(it.id));
                 listItem->setData(Qt::UserRole + 1, QString::fromStdString(it.pdf_path));
                 if (!it.pdf_path.empty()) listItem->setToolTip(QString::fromStdString(it.pdf_path));
                 ui->itemsList->addItem(listItem);
             }
-        }
+        });
     });
 
     // Initialize bib settings menu state from QSettings and show as mutually-exclusive checks
     QSettings settings("bello", "bello");
     int pref = settings.value("export/bibkey", 1).toInt();
     if (pref == 1) opt1->setChecked(true); else opt2->setChecked(true);
+    bibtex.setKeyPreference(pref);
     connect(opt1, &QAction::triggered, [this]() {
         QSettings("bello","bello").setValue("export/bibkey", 1);
+        bibtex.setKeyPreference(1);
     });
     connect(opt2, &QAction::triggered, [this]() {
         QSettings("bello","bello").setValue("export/bibkey", 2);
+        bibtex.setKeyPreference(2);
+    });
+    reclaimOpt->setChecked(settings.value("storage/reclaim", false).toBool());
+    connect(reclaimOpt, &QAction::toggled, [](bool on) {
+        QSettings("bello","bello").setValue("storage/reclaim", on);
+    });
+
+    // Auto-save: edits mark fields dirty and are written in one patch when typing pauses,
+    // focus moves or the selection changes
+    autosaveTimer = new QTimer(this);
+    autosaveTimer->setSingleShot(true);
+    autosaveTimer->setInterval(750);
+    connect(autosaveTimer, &QTimer::timeout, this, &MainWindow::flushPendingEdits);
+    connect(qApp, &QApplication::focusChanged, this, [this](QWidget *, QWidget *) {
+        if (!dirtyFields.isEmpty()) flushPendingEdits();
+    });
+
+    // Linked .bib files: each file and its directory are watched, since editors that
+    // save through a temporary file replace the watched file and drop its watch
+    bibWatcher = new QFileSystemWatcher(this);
+    bibSyncTimer = new QTimer(this);
+    bibSyncTimer->setSingleShot(true);
+    bibSyncTimer->setInterval(500);
+    connect(bibSyncTimer, &QTimer::timeout, this, &MainWindow::syncPendingBibs);
+    connect(bibWatcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+        pendingBibSyncs.insert(path);
+        bibSyncTimer->start();
+    });
+    connect(bibWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &dir) {
+        const QStringList watched = bibWatcher->files();
+        for (const auto &f : db->listLinkedBibFiles()) {
+            const QString path = QString::fromStdString(f.path);
+            if (QFileInfo(path).absolutePath() == dir && !watched.contains(path)) pendingBibSyncs.insert(path);
+        }
+        if (!pendingBibSyncs.isEmpty()) bibSyncTimer->start();
+    });
+    watchLinkedBibs();
+    // Pick up edits made while Bello was not running
+    for (const auto &f : db->listLinkedBibFiles()) pendingBibSyncs.insert(QString::fromStdString(f.path));
+    if (!pendingBibSyncs.isEmpty()) bibSyncTimer->start();
+
+    // Live exports: changes are batched for a second, so a bulk import rewrites each file once
+    liveExportTimer = new QTimer(this);
+    liveExportTimer->setSingleShot(true);
+    liveExportTimer->setInterval(1000);
+    connect(liveExportTimer, &QTimer::timeout, this, &MainWindow::syncLiveExports);
+    db->addChangeListener([this](const DbChange &) {
+        if (!liveExportTimer->isActive()) liveExportTimer->start();
+    });
+    liveExportTimer->start();
+
+    // Attachment status: new attachments are scanned two seconds after an item change; a
+    // change in a watched directory rescans the attachments under it
+    attachmentWatcher = new QFileSystemWatcher(this);
+    attachmentScanTimer = new QTimer(this);
+    attachmentScanTimer->setSingleShot(true);
+    connect(attachmentScanTimer, &QTimer::timeout, this, &MainWindow::scanAttachments);
+    connect(attachmentWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &dir) {
+        db->invalidateAttachmentDir(dir.toStdString());
+        attachmentScanTimer->start(500);
     });
+    db->addChangeListener([this](const DbChange &c) {
+        if (c.kind != DbChange::ItemInserted && c.kind != DbChange::ItemUpdated && c.kind != DbChange::ItemDeleted) return;
+        attachmentsChanged = true;
+        if (!attachmentScanTimer->isActive() || attachmentScanTimer->remainingTime() > 2000) attachmentScanTimer->start(2000);
+    });
+    attachmentScanTimer->start(0);
+
+    // Storage garbage collection: the first pass starts a minute after launch
+    storageGcTimer = new QTimer(this);
+    storageGcTimer->setSingleShot(true);
+    connect(storageGcTimer, &QTimer::timeout, this, &MainWindow::collectStorage);
+    storageGcTimer->start(60 * 1000);
 
-    // Auto-save
-    connect(ui->title, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
-    connect(ui->authors, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
-    connect(ui->year, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
-    connect(ui->isbn, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
-    connect(ui->doi, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
+    const std::pair<QLineEdit*, QString> coreFields[] = {
+        {ui->title, "title"}, {ui->authors, "authors"}, {ui->year, "year"}, {ui->isbn, "isbn"}, {ui->doi, "doi"}
+    };
+    for (const auto &cf : coreFields) {
+        const QString field = cf.second;
+        connect(cf.first, &QLineEdit::textEdited, this, [this, field]() { markFieldDirty(field); });
+        connect(cf.first, &QLineEdit::editingFinished, this, &MainWindow::onSaveItem);
+    }
     connect(ui->entryType, &QComboBox::currentTextChanged, [this](const QString &){
         if (!ui->entryType->signalsBlocked()) {
-            populateDynamicFields(ui->entryType->currentText(), nullptr);
-            onSaveItem();
+            markFieldDirty("type");
+            flushPendingEdits();
+            // Switch to the new type's field set, refilled from the saved item
+            onItemSelected();
         }
     });
     connect(ui->collectionCheckList, &QListWidget::itemChanged, this, &MainWindow::onCollectionCheckChanged);
@@ -235,18 +310,7 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
         QApplication::clipboard()->setText(citations.join("\n\n"));
     });
     auto *scBib = new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_B), this);
-    connect(scBib, &QShortcut::activated, [this](){
-        auto selectedItems = ui->itemsList->selectedItems();
-        if (selectedItems.isEmpty()) return;
-        QStringList bibTexEntries;
-        for (auto *it : selectedItems) {
-            Item item;
-            if (db->getItem(it->data(Qt::UserRole).toString().toStdString(), item)) {
-                bibTexEntries << itemToBibTeX(item);
-            }
-        }
-        QApplication::clipboard()->setText(bibTexEntries.join("\n\n"));
-    });
+    connect(scBib, &QShortcut::activated, this, &MainWindow::copySelectedAsBibTeX);
 
     auto *scSelectAll = new QShortcut(QKeySequence::SelectAll, ui->itemsList);
     connect(scSelectAll, &QShortcut::activated, [this](){
@@ -277,5 +341,11 @@ inline MainWindow::MainWindow(const std::string &dbPath, QWidget *parent) : QMai
 }
 
 inline MainWindow::~MainWindow() {
+    flushPendingEdits();
+    if (attachmentScanThread) {
+        attachmentScanThread->requestInterruption();
+        attachmentScanThread->wait();
+    }
+    if (storageGcThread) storageGcThread->wait();
     delete ui;
 }
@@ -0,0 +1,445 @@
+// bello-cli: headless access to a Bello library for scripts and server jobs.
+//
+//   bello-cli [--db=PATH] import FILE... [--collection=NAME] [--format=bib|rdf|endnote|mendeley]
+//                                        [--allow-duplicates]
+//   bello-cli [--db=PATH] export [--collection=NAME] [--format=bib|jsonl] [--out=FILE]
+//                                        [--keep [--key=1|2] | --keep --remove]
+//   bello-cli [--db=PATH] search TEXT [--collection=NAME] [--limit=N] [--format=tsv|jsonl|bib]
+//   bello-cli [--db=PATH] dedupe [--fuzzy [--threshold=0.8]] [--delete]
+//   bello-cli [--db=PATH] link FILE [--collection=NAME] | link --remove FILE
+//   bello-cli [--db=PATH] sync
+//   bello-cli [--db=PATH] stats
+//   bello-cli [--db=PATH] gc [--storage=DIR] [--reclaim] [--budget=N]
+//
+// The database defaults to the one the GUI uses. Results are written as they
+// are read from the database, so exports of any size run in constant memory.
+// No QApplication is created.
+
+#include "BibTeX.h"
+#include "Database.h"
+#include "Dedupe.h"
+#include "Identifiers.h"
+#include "Importers.h"
+#include "LinkedBib.h"
+#include "LiveExport.h"
+#include "StorageGC.h"
+
+#include <QFileInfo>
+#include <QString>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Args {
+    std::string dbPath;
+    std::string command;
+    std::vector<std::string> positional;
+    std::map<std::string, std::string> flags;   // "--name=value" and bare "--name" (value "1")
+
+    std::string flag(const std::string &name, const std::string &fallback = std::string()) const {
+        auto f = flags.find(name);
+        return f == flags.end() ? fallback : f->second;
+    }
+    bool has(const std::string &name) const { return flags.count(name) > 0; }
+};
+
+int usage(int code) {
+    std::cerr << "usage: bello-cli [--db=PATH] <command> [options]\n"
+                 "\n"
+                 "  import FILE... [--collection=NAME] [--format=bib|rdf|endnote|mendeley] [--allow-duplicates]\n"
+                 "  export [--collection=NAME] [--format=bib|jsonl] [--out=FILE] [--keep [--key=1|2] | --keep --remove]\n"
+                 "  search TEXT [--collection=NAME] [--limit=N] [--format=tsv|jsonl|bib]\n"
+                 "  dedupe [--fuzzy [--threshold=0.8]] [--delete]\n"
+                 "  link FILE [--collection=NAME] | link --remove FILE\n"
+                 "  sync\n"
+                 "  stats\n"
+                 "  gc [--storage=DIR] [--reclaim] [--budget=N]\n";
+    return code;
+}
+
+std::string defaultDbPath() {
+    const char *home = std::getenv("HOME");
+    return std::string(home ? home : ".") + "/.local/share/bello/bello.db";
+}
+
+std::string lower(std::string s) {
+    for (auto &c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+bool endsWith(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Same extension rules as the GUI import dialog; "xml" tries EndNote, then Mendeley
+std::vector<Item> parseFile(const std::string &path, const std::string &format) {
+    const QString p = QString::fromStdString(path);
+    const std::string f = format.empty() ? lower(path) : format;
+    if (f == "bib" || endsWith(f, ".bib")) return parseBibTeXFile(p);
+    if (f == "rdf" || endsWith(f, ".rdf")) return parseZoteroRDFFile(p);
+    if (f == "endnote") return parseEndNoteXMLFile(p);
+    if (f == "mendeley") return parseMendeleyXMLFile(p);
+    if (endsWith(f, ".xml")) {
+        auto items = parseEndNoteXMLFile(p);
+        if (items.empty()) items = parseMendeleyXMLFile(p);
+        return items;
+    }
+    std::cerr << "unsupported file type: " << path << "\n";
+    return {};
+}
+
+std::string jsonString(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) { char buf[8]; std::snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+            else out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void writeJsonLine(std::ostream &out, const Item &it) {
+    const std::pair<const char*, const std::string*> fields[] = {
+        {"id", &it.id}, {"type", &it.type}, {"title", &it.title}, {"authors", &it.authors}, {"year", &it.year},
+        {"doi", &it.doi}, {"isbn", &it.isbn}, {"journal", &it.journal}, {"booktitle", &it.booktitle},
+        {"publisher", &it.publisher}, {"volume", &it.volume}, {"number", &it.number}, {"pages", &it.pages},
+        {"url", &it.url}, {"abstract", &it.abstract}, {"keywords", &it.keywords}, {"note", &it.note},
+        {"pdf_path", &it.pdf_path}, {"collection", &it.collection}, {"modified", &it.modified},
+    };
+    out << '{';
+    bool first = true;
+    for (const auto &f : fields) {
+        if (f.second->empty()) continue;
+        if (!first) out << ',';
+        out << jsonString(f.first) << ':' << jsonString(*f.second);
+        first = false;
+    }
+    out << "}\n";
+}
+
+int runImport(Database &db, const Args &args) {
+    if (args.positional.empty()) return usage(2);
+    const std::string collection = args.flag("--collection");
+    const bool allowDuplicates = args.has("--allow-duplicates");
+    size_t parsed = 0;
+    ImportStats total;
+    for (const auto &path : args.positional) {
+        std::vector<Item> items = parseFile(path, args.flag("--format"));
+        parsed += items.size();
+        ImportStats stats = importItems(db, std::move(items), collection, !allowDuplicates);
+        total.added += stats.added;
+        total.merged += stats.merged;
+    }
+    std::cerr << "parsed " << parsed << ", imported " << total.added << ", merged " << total.merged << " into existing items\n";
+    return 0;
+}
+
+// --keep: bind the collection to --out and keep the file current (see LiveExport.h)
+int runKeepExported(Database &db, const Args &args) {
+    const std::string outPath = args.flag("--out");
+    if (outPath.empty() || args.flag("--format", "bib") != "bib") return usage(2);
+    const std::string path = QFileInfo(QString::fromStdString(outPath)).absoluteFilePath().toStdString();
+    if (args.has("--remove")) {
+        db.removeLiveExport(path);
+        return 0;
+    }
+    LiveExportSync s = startLiveExport(db, path, args.flag("--collection"), std::atoi(args.flag("--key", "1").c_str()) == 2 ? 2 : 1);
+    if (!s.ok) { std::cerr << "cannot write " << path << "\n"; return 1; }
+    std::cerr << "exported " << s.formatted + s.copied << " items, kept in sync by 'bello-cli sync' and the GUI\n";
+    return 0;
+}
+
+int runExport(Database &db, const Args &args) {
+    if (args.has("--keep")) return runKeepExported(db, args);
+    const std::string format = args.flag("--format", "bib");
+    if (format != "bib" && format != "jsonl") return usage(2);
+    std::ofstream file;
+    const std::string outPath = args.flag("--out");
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) { std::cerr << "cannot open " << outPath << "\n"; return 1; }
+    }
+    std::ostream &out = outPath.empty() ? std::cout : file;
+    ItemQuery q;
+    q.limit = 0;
+    q.collection = args.flag("--collection");
+    size_t n = 0;
+    if (format == "bib") {
+        n = exportBibTeX(db, q, BibTeXExporter(), [&out](const QByteArray &block) { out.write(block.constData(), block.size()); });
+        if (n) out << "\n";
+    } else {
+        db.queryItems(q, [&](const std::vector<Item> &chunk) {
+            for (const auto &it : chunk) writeJsonLine(out, it);
+            n += chunk.size();
+        });
+    }
+    out.flush();
+    std::cerr << "exported " << n << " items\n";
+    return out ? 0 : 1;
+}
+
+int runSearch(Database &db, const Args &args) {
+    if (args.positional.size() != 1) return usage(2);
+    const std::string format = args.flag("--format", "tsv");
+    if (format != "tsv" && format != "jsonl" && format != "bib") return usage(2);
+    ItemQuery q;
+    q.search = args.positional[0];
+    q.collection = args.flag("--collection");
+    q.limit = std::atoi(args.flag("--limit", "0").c_str());
+    const BibTeXExporter bibtex;
+    QByteArray entry;
+    db.queryItems(q, [&](const std::vector<Item> &chunk) {
+        for (const auto &it : chunk) {
+            if (format == "bib") {
+                entry.truncate(0);
+                bibtex.append(it, entry);
+                std::cout.write(entry.constData(), entry.size()) << "\n\n";
+            } else if (format == "jsonl") writeJsonLine(std::cout, it);
+            else std::cout << it.id << '\t' << it.year << '\t' << it.title << '\t' << it.authors << '\t' << it.doi << '\n';
+        }
+    });
+    return 0;
+}
+
+// Near-duplicates by title and authors (Database::findDuplicateClusters), reported
+// as "duplicate-id <TAB> kept-id <TAB> fuzzy:<similarity>". --delete merges each
+// cluster into its oldest item instead of dropping the others' data.
+int runFuzzyDedupe(Database &db, const Args &args) {
+    double threshold = 0.8;
+    try {
+        threshold = std::stod(args.flag("--threshold", "0.8"));
+    } catch (std::exception &) {
+        std::cerr << "bad --threshold\n";
+        return 2;
+    }
+    auto clusters = db.findDuplicateClusters(threshold);
+    size_t duplicates = 0;
+    for (const auto &c : clusters) {
+        for (size_t i = 1; i < c.ids.size(); ++i) std::cout << c.ids[i] << '\t' << c.ids[0] << "\tfuzzy:" << c.similarity << '\n';
+        duplicates += c.ids.size() - 1;
+    }
+    if (args.has("--delete")) {
+        for (const auto &c : clusters) mergeDuplicates(db, c.ids[0], std::vector<std::string>(c.ids.begin() + 1, c.ids.end()));
+        std::cerr << "merged " << duplicates << " duplicates in " << clusters.size() << " clusters\n";
+    } else {
+        std::cerr << duplicates << " near-duplicates in " << clusters.size() << " clusters\n";
+    }
+    return 0;
+}
+
+// Reports each duplicate as "duplicate-id <TAB> kept-id <TAB> matched key".
+// The oldest item (by modification time) of each group is kept; --delete merges the
+// others into it (mergeDuplicates), so their collections and attachments move over.
+int runDedupe(Database &db, const Args &args) {
+    if (args.has("--fuzzy")) return runFuzzyDedupe(db, args);
+    std::vector<Item> all;
+    ItemQuery q;
+    q.limit = 0;
+    db.queryItems(q, [&](const std::vector<Item> &chunk) {
+        for (const auto &it : chunk) {
+            Item slim;
+            slim.id = it.id; slim.doi = it.doi; slim.isbn = it.isbn;
+            slim.title = it.title; slim.authors = it.authors; slim.modified = it.modified;
+            all.push_back(std::move(slim));
+        }
+    });
+    std::stable_sort(all.begin(), all.end(), [](const Item &a, const Item &b) { return a.modified < b.modified; });
+
+    std::unordered_map<std::string, size_t> owner;
+    std::map<size_t, std::vector<std::string>> groups;   // kept item -> its duplicates
+    size_t duplicates = 0;
+    for (size_t i = 0; i < all.size(); ++i) {
+        auto keys = identityKeys(all[i]);
+        const std::string *matched = nullptr;
+        size_t keep = 0;
+        for (const auto &k : keys) {
+            auto f = owner.find(k);
+            if (f != owner.end()) { matched = &f->first; keep = f->second; break; }
+        }
+        if (matched) {
+            std::cout << all[i].id << '\t' << all[keep].id << '\t' << *matched << '\n';
+            groups[keep].push_back(all[i].id);
+            ++duplicates;
+            continue;
+        }
+        for (auto &k : keys) owner.emplace(std::move(k), i);
+    }
+    if (args.has("--delete")) {
+        for (const auto &g : groups) mergeDuplicates(db, all[g.first].id, g.second);
+        std::cerr << "merged " << duplicates << " duplicates of " << all.size() << " items\n";
+    } else {
+        std::cerr << duplicates << " duplicates among " << all.size() << " items\n";
+    }
+    return 0;
+}
+
+void printSync(const std::string &path, const LinkedBibSync &s) {
+    if (!s.ok) { std::cerr << path << ": cannot read\n"; return; }
+    std::cerr << path << ": " << s.added << " added, " << s.updated << " updated, " << s.removed << " removed, "
+              << s.unchanged << " unchanged\n";
+}
+
+int runLink(Database &db, const Args &args) {
+    if (args.positional.size() != 1) return usage(2);
+    // Same spelling as linkBibliography stores
+    const std::string path = QFileInfo(QString::fromStdString(args.positional[0])).absoluteFilePath().toStdString();
+    if (args.has("--remove")) {
+        db.unlinkBibFile(path);
+        return 0;
+    }
+    LinkedBibSync s = linkBibliography(db, path, args.flag("--collection"));
+    printSync(path, s);
+    return s.ok ? 0 : 1;
+}
+
+// Re-sync every linked file, e.g. after a checkout changed them, then every live export
+int runSync(Database &db) {
+    int rc = 0;
+    for (const auto &f : db.listLinkedBibFiles()) {
+        LinkedBibSync s = syncLinkedBib(db, f.path);
+        printSync(f.path, s);
+        if (!s.ok) rc = 1;
+    }
+    for (const auto &e : db.listLiveExports()) {
+        LiveExportSync s = syncLiveExport(db, e.path);
+        if (!s.ok) { std::cerr << e.path << ": cannot write\n"; rc = 1; continue; }
+        if (!s.rewritten) continue;
+        std::cerr << e.path << ": " << s.formatted << " written, " << s.copied << " kept, " << s.removed << " removed\n";
+    }
+    return rc;
+}
+
+int runStats(Database &db, const std::string &dbPath) {
+    size_t items = 0, withPdf = 0, withAbstract = 0, withDoi = 0;
+    std::map<std::string, size_t> types;
+    ItemQuery q;
+    q.limit = 0;
+    db.queryItems(q, [&](const std::vector<Item> &chunk) {
+        for (const auto &it : chunk) {
+            ++items;
+            if (!it.pdf_path.empty()) ++withPdf;
+            if (!it.abstract.empty()) ++withAbstract;
+            if (!it.doi.empty()) ++withDoi;
+            ++types[it.type.empty() ? "misc" : lower(it.type)];
+        }
+    });
+    std::error_code ec;
+    auto size = std::filesystem::file_size(dbPath, ec);
+    std::cout << "database\t" << dbPath << "\n";
+    if (!ec) std::cout << "file_bytes\t" << size << "\n";
+    std::cout << "items\t" << items << "\n";
+    std::cout << "collections\t" << db.listCollections().size() << "\n";
+    std::cout << "with_pdf\t" << withPdf << "\n";
+    std::cout << "with_abstract\t" << withAbstract << "\n";
+    std::cout << "with_doi\t" << withDoi << "\n";
+    for (const auto &t : types) std::cout << "type." << t.first << "\t" << t.second << "\n";
+    return 0;
+}
+
+// Lists files in the storage directory that no attachment refers to, and directories
+// holding nothing else, as "file|dir <TAB> bytes <TAB> path"; --reclaim deletes them.
+// The storage is walked --budget entries at a time, each step confirmed against the database.
+// The storage directory is the GUI's; another --db needs its own --storage, or its
+// attachments would not count and the GUI library's files would look orphaned.
+int runGc(Database &db, const Args &args) {
+    const long budget = std::atol(args.flag("--budget", "10000").c_str());
+    if (budget <= 0) return usage(2);
+    const bool reclaim = args.has("--reclaim");
+    std::string storage = args.flag("--storage");
+    if (storage.empty()) {
+        const auto normal = [](const std::string &p) { return std::filesystem::absolute(p).lexically_normal(); };
+        if (normal(args.dbPath) != normal(defaultDbPath())) {
+            std::cerr << "gc: " << args.dbPath << " is not the default library; pass its --storage=DIR\n";
+            return 2;
+        }
+        storage = attachmentStorageDir();
+    }
+    const unsigned threads = std::max(2u, std::thread::hardware_concurrency() / 2);
+    StorageCollector gc(storage);
+    gc.prepare(db);
+    StorageReclaimed found, removed;
+    do {
+        gc.walk(size_t(budget), threads);
+        const std::vector<StorageOrphan> orphans = gc.confirm(db);
+        for (const auto &o : orphans) {
+            std::cout << (o.directory ? "dir" : "file") << '\t' << o.size << '\t' << o.path << '\n';
+            if (o.directory) ++found.directories;
+            else { ++found.files; found.bytes += o.size; }
+        }
+        if (reclaim && !orphans.empty()) {
+            const StorageReclaimed r = StorageCollector::reclaim(orphans);
+            removed.files += r.files;
+            removed.directories += r.directories;
+            removed.bytes += r.bytes;
+        }
+    } while (!gc.passDone());
+    std::cerr << found.files << " orphaned files (" << found.bytes << " bytes) and " << found.directories
+              << " empty directories among " << gc.visited() << " entries\n";
+    if (reclaim) {
+        std::cerr << "removed " << removed.files << " files (" << removed.bytes << " bytes) and "
+                  << removed.directories << " directories\n";
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::ios::sync_with_stdio(false);
+    Args args;
+    args.dbPath = defaultDbPath();
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") return usage(0);
+        if (a.rfind("--", 0) == 0) {
+            auto eq = a.find('=');
+            std::string name = a.substr(0, eq);
+            std::string value = eq == std::string::npos ? "1" : a.substr(eq + 1);
+            if (name == "--db") args.dbPath = value;
+            else args.flags[name] = value;
+        } else if (args.command.empty()) {
+            args.command = a;
+        } else {
+            args.positional.push_back(a);
+        }
+    }
+    if (args.command.empty()) return usage(2);
+    static const char *commands[] = {"import", "export", "search", "dedupe", "link", "sync", "stats", "gc"};
+    if (std::none_of(std::begin(commands), std::end(commands), [&](const char *c) { return args.command == c; })) {
+        std::cerr << "unknown command: " << args.command << "\n";
+        return usage(2);
+    }
+
+    { std::filesystem::path p(args.dbPath); if (p.has_parent_path()) std::filesystem::create_directories(p.parent_path()); }
+    Database db(args.dbPath);
+    db.init();
+
+    int rc = 2;
+    if (args.command == "import") rc = runImport(db, args);
+    else if (args.command == "export") rc = runExport(db, args);
+    else if (args.command == "search") rc = runSearch(db, args);
+    else if (args.command == "dedupe") rc = runDedupe(db, args);
+    else if (args.command == "link") rc = runLink(db, args);
+    else if (args.command == "sync") rc = runSync(db);
+    else if (args.command == "stats") rc = runStats(db, args.dbPath);
+    else if (args.command == "gc") rc = runGc(db, args);
+    std::cout.flush();
+    return rc;
+}
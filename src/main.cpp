@@ -3,6 +3,7 @@
 #include "Importers.h"
 #include <cstdlib>
 #include <filesystem>
+#include <iostream>
 #include <string>
 
 int main(int argc, char **argv) {